@@ -0,0 +1,30 @@
+/*
+ * hal.h
+ * the little bit of hardware the firmware logic needs, in one place
+ *
+ * on the ATmega this is just the avr-libc headers.  built with -DHOST (the benchmark harness, see host/),
+ * host/host.h stands in for them instead: registers are plain variables, ISRs are functions the harness
+ * calls, and every byte sent over SPI goes through SPI_SEND() so the harness sees it
+ */
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#ifdef HOST
+
+#include "host/host.h"
+
+#else
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+#include <util/delay.h>
+#include <avr/power.h>
+
+#define SPI_SEND(b) (SPDR = (b)) // start shifting a byte out to the slave
+
+#endif
+
+#endif /* HAL_H_ */
@@ -27,6 +27,7 @@
 #include <stdint.h>
 
 #include <avr/io.h>
+#include <util/atomic.h>
 #include <util/delay.h>
 
 #include "hd44780.h"
@@ -102,7 +103,9 @@ hd44780_pulse_e(bool readback)
 }
 
 /*
- * Send one nibble out to the LCD controller.
+ * Send one nibble out to the LCD controller.  The data nibble shares
+ * its port with the SPI SS line, which the SPI interrupt toggles, so
+ * the read-modify-write mustn't be interrupted.
  */
 static void
 hd44780_outnibble(uint8_t n, uint8_t rs)
@@ -112,7 +115,10 @@ hd44780_outnibble(uint8_t n, uint8_t rs)
     SET(PORT, HD44780_RS);
   else
     CLR(PORT, HD44780_RS);
-  ASSIGN(PORT, HD44780_D4, n);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    ASSIGN(PORT, HD44780_D4, n);
+  }
   (void)hd44780_pulse_e(false);
 }
 
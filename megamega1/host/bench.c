@@ -0,0 +1,453 @@
+/*
+ * bench.c
+ * benchmark harness for the megamega1 firmware logic, built natively with "make bench" in Debug/
+ *
+ * usage: megamega1_bench [-w us] file.mid
+ *
+ * replays a standard MIDI file through the firmware at real time: every byte goes in through the USART ISR
+ * at 31250 baud, timer1 overflows and timer0 compare matches fire when they would on the chip (16 MHz), and
+ * mainLoop() runs in between.  everything sent over SPI is decoded the way ym2612c.c decodes it, and counted
+ * against whatever caused it: the MIDI message that was just received, or a timer tick (control tick, soft LFO,
+ * and anything they finish later like a program change waiting for the notes to be released)
+ *
+ * for each kind of event it prints how many there were, the YM2612 register writes, SPI bytes and frames they
+ * caused (total and most from one event), and the modeled bus time: SPI bytes at the clock rate the firmware set
+ * in SPCR/SPSR plus the SS gap between frames, and YM2612 writes at -w us each (13 us default: the
+ * worst case datasheet waits ym2612c.c uses without the busy flag, 17 + 83 YM2612 clock cycles at 8 MHz, plus the bus)
+ *
+ * SPI bytes are done the moment they're sent in the host build, so the MIDI and SPI queues never back up here -
+ * this counts the work, it doesn't find out whether the chip keeps up with it
+ *
+ * main.c is included rather than linked so the harness can see glb
+ */
+
+#include "../main.c"
+
+#include <stdlib.h>
+
+#define CYCLES_PER_BYTE 5120 // 10 bits at 31250 baud
+#define TIMER1_CYCLES 65536UL
+#define TIMER0_CYCLES 64000UL // prescale 256, OCR0A 249
+#define SPI_BYTE_GAP 40 // cycles between SPI bytes for the ISR to load the next one
+
+// what caused the SPI traffic
+enum {
+	EV_NOTE_ON,
+	EV_NOTE_OFF,
+	EV_CONTROL,
+	EV_AFTERTOUCH,
+	EV_BEND,
+	EV_PROGRAM,
+	EV_OTHER,
+	EV_TICKS,
+	EV_KINDS
+};
+
+const char* evNames[EV_KINDS] = {"note on", "note off", "controller", "aftertouch", "bend", "program", "other", "ticks"};
+
+struct Stats {
+	uint32_t count;
+	uint32_t writes;
+	uint32_t bytes;
+	uint32_t frames;
+	uint32_t maxWrites;
+	uint32_t maxBytes;
+};
+
+struct Event {
+	uint32_t tick;
+	uint32_t order; // position in the file, so events on the same tick stay in order
+	uint32_t tempo; // us per quarter note when this event happens
+	uint8_t msg[3];
+	uint8_t len;
+};
+
+struct Stats stats[EV_KINDS];
+
+struct Event* events;
+uint32_t eventCount;
+uint32_t eventSize;
+
+uint64_t now; // cycles since init()
+uint64_t nextOvf;
+uint64_t nextSoft;
+
+// SPI decoding, same states as the slave
+uint8_t spiState; // 0 header, 1 count, 2 reg, 3 data
+uint8_t spiHeader;
+uint8_t spiCount;
+
+// counts for the event being run
+uint32_t evWrites;
+uint32_t evBytes;
+uint32_t evFrames;
+
+// every byte the firmware sends over SPI, followed through the frame it belongs to
+void spiCapture(uint8_t b){
+	++evBytes;
+
+	switch(spiState){
+		case 0:
+			++evFrames;
+			spiHeader = b;
+			spiState = (b & FRAME_BURST) && b != FRAME_DAC ? 1 : 2;
+			spiCount = 1;
+			break;
+		case 1:
+			spiCount = b;
+			spiState = b ? 2 : 0;
+			break;
+		case 2:
+			spiState = 3;
+			break;
+		case 3:
+			if(spiHeader == FRAME_DAC){
+				// no register writes over SPI, the slave plays the sample from its own flash
+			} else if((spiHeader & 0xC0) == FRAME_BCAST){
+				evWrites += 6;
+			} else if((spiHeader & 0x03) == 2){
+				evWrites += 2;
+			} else {
+				evWrites += 1;
+			}
+
+			spiState = --spiCount ? 2 : 0;
+			break;
+	}
+}
+
+// add up what the event that just ran sent
+void account(uint8_t kind){
+	struct Stats* s = &stats[kind];
+
+	++s->count;
+	s->writes += evWrites;
+	s->bytes += evBytes;
+	s->frames += evFrames;
+	if(evWrites > s->maxWrites) s->maxWrites = evWrites;
+	if(evBytes > s->maxBytes) s->maxBytes = evBytes;
+
+	evWrites = 0;
+	evBytes = 0;
+	evFrames = 0;
+}
+
+// send whatever is queued - SPIF is already set, so it's just the ISR over and over
+void spiDrain(){
+	while(glb.spiBusy) SPI_STC_vect();
+}
+
+// one pass of the main loop, with the clock at now
+void run(){
+	TCNT1 = (uint16_t)now;
+	mainLoop();
+	spiDrain();
+}
+
+// move the clock up to t, firing the timer interrupts that come due on the way
+void advance(uint64_t t){
+	while(nextOvf <= t || nextSoft <= t){
+		if(nextOvf <= nextSoft){
+			now = nextOvf;
+			nextOvf += TIMER1_CYCLES;
+			TCNT1 = 0;
+			TIMER1_OVF_vect();
+		} else {
+			now = nextSoft;
+			nextSoft += TIMER0_CYCLES;
+			TCNT1 = (uint16_t)now;
+			TIMER0_COMPA_vect();
+		}
+
+		run();
+		account(EV_TICKS);
+	}
+
+	now = t;
+}
+
+// MIDI message -> what kind of event it is
+uint8_t eventKind(const uint8_t* msg){
+	switch(msg[0] & 0xF0){
+		case 0x90: return msg[2] ? EV_NOTE_ON : EV_NOTE_OFF;
+		case 0x80: return EV_NOTE_OFF;
+		case 0xB0: return EV_CONTROL;
+		case 0xA0:
+		case 0xD0: return EV_AFTERTOUCH;
+		case 0xE0: return EV_BEND;
+		case 0xC0: return EV_PROGRAM;
+		default: return EV_OTHER;
+	}
+}
+
+// the message goes in byte by byte like it would over the wire, then the main loop gets to it
+void play(const struct Event* e){
+	for(uint8_t i = 0; i < e->len; i++){
+		advance(now + CYCLES_PER_BYTE);
+		UDR0 = e->msg[i];
+		TCNT1 = (uint16_t)now;
+		USART_RX_vect();
+	}
+
+	do {
+		run();
+	} while(glb.midiTail != glb.midiHead);
+
+	account(eventKind(e->msg));
+}
+
+////////////////////////////// MIDI FILE ///////////////////////////////////
+
+uint32_t readBig(const uint8_t* p, uint8_t len){
+	uint32_t value = 0;
+
+	while(len--) value = (value << 8) | *p++;
+
+	return value;
+}
+
+// variable length quantity, stops at end
+uint32_t readVarLen(const uint8_t** p, const uint8_t* end){
+	uint32_t value = 0;
+
+	while(*p < end){
+		uint8_t b = *(*p)++;
+		value = (value << 7) | (b & 0x7F);
+		if(!(b & 0x80)) break;
+	}
+
+	return value;
+}
+
+void addEvent(uint32_t tick, const uint8_t* msg, uint8_t len){
+	if(eventCount == eventSize){
+		eventSize = eventSize ? 2*eventSize : 1024;
+		events = realloc(events, eventSize * sizeof(struct Event));
+		if(!events){
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+
+	struct Event* e = &events[eventCount];
+	e->tick = tick;
+	e->order = eventCount;
+	e->tempo = 0; // only used by tempo changes
+	e->len = len;
+	memcpy(e->msg, msg, len);
+	++eventCount;
+}
+
+// tempo changes are kept as events with no message so they sort in with the rest
+void addTempo(uint32_t tick, uint32_t tempo){
+	uint8_t none[3] = {0};
+
+	addEvent(tick, none, 0);
+	events[eventCount - 1].tempo = tempo;
+}
+
+// one MTrk chunk: channel messages (with running status) and tempo, everything else is skipped
+void readTrack(const uint8_t* p, const uint8_t* end){
+	uint32_t tick = 0;
+	uint8_t status = 0;
+
+	while(p < end){
+		tick += readVarLen(&p, end);
+		if(p >= end) break;
+
+		uint8_t b = *p;
+
+		if(b == 0xFF){ // meta event
+			if(p + 2 > end) break;
+			uint8_t type = p[1];
+			p += 2;
+			uint32_t len = readVarLen(&p, end);
+			if(p + len > end) break;
+
+			if(type == 0x51 && len == 3) addTempo(tick, readBig(p, 3));
+			if(type == 0x2F) break; // end of track
+
+			p += len;
+		} else if(b == 0xF0 || b == 0xF7){ // sysex
+			++p;
+			uint32_t len = readVarLen(&p, end);
+			p += len;
+		} else {
+			if(b & 0x80){
+				status = b;
+				++p;
+			}
+			if(!status) break; // data with no status, the file is broken
+
+			uint8_t msg[3] = {status, 0, 0};
+			uint8_t len = ((status & 0xE0) == 0xC0) ? 2 : 3; // program change and channel pressure have one data byte
+
+			if(p + len - 1 > end) break;
+			for(uint8_t i = 1; i < len; i++) msg[i] = *p++;
+
+			addEvent(tick, msg, len);
+		}
+	}
+}
+
+int eventCompare(const void* a, const void* b){
+	const struct Event* x = a;
+	const struct Event* y = b;
+
+	if(x->tick != y->tick) return x->tick < y->tick ? -1 : 1;
+
+	return x->order < y->order ? -1 : (x->order > y->order);
+}
+
+// read the whole file into events, sorted by time, returns ticks per quarter note (0 if it couldn't)
+uint16_t readMidiFile(const char* path){
+	FILE* f = fopen(path, "rb");
+	uint8_t* data;
+	long size;
+	uint16_t division;
+
+	if(!f){
+		perror(path);
+		return 0;
+	}
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	data = malloc(size);
+	if(!data || fread(data, 1, size, f) != (size_t)size){
+		fprintf(stderr, "%s: can't read\n", path);
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+
+	if(size < 14 || memcmp(data, "MThd", 4)){
+		fprintf(stderr, "%s: not a MIDI file\n", path);
+		return 0;
+	}
+
+	division = readBig(data + 12, 2);
+	if(division & 0x8000){
+		fprintf(stderr, "%s: SMPTE time isn't supported\n", path);
+		return 0;
+	}
+
+	const uint8_t* p = data + 8 + readBig(data + 4, 4);
+	const uint8_t* end = data + size;
+
+	while(p + 8 <= end){
+		uint32_t len = readBig(p + 4, 4);
+		const uint8_t* chunk = p + 8;
+
+		if(chunk + len > end) len = end - chunk;
+		if(!memcmp(p, "MTrk", 4)) readTrack(chunk, chunk + len);
+
+		p = chunk + len;
+	}
+
+	free(data);
+
+	qsort(events, eventCount, sizeof(struct Event), eventCompare);
+
+	return division;
+}
+
+////////////////////////////// MAIN ///////////////////////////////////
+
+void usage(){
+	fprintf(stderr, "usage: megamega1_bench [-w us] file.mid\n");
+	exit(2);
+}
+
+int main(int argc, char** argv){
+	double ymWriteUs = 13.0;
+	const char* path = NULL;
+	uint16_t division;
+	uint32_t tempo = 500000; // 120 bpm until the file says otherwise
+	uint32_t lastTick = 0;
+	double cycles = 0; // fractional cycles since the last event, so rounding doesn't add up
+	uint64_t base;
+	FILE* out = stdout; // init() points stdout at the LCD
+
+	for(int i = 1; i < argc; i++){
+		if(!strcmp(argv[i], "-w") && i + 1 < argc) ymWriteUs = atof(argv[++i]);
+		else if(argv[i][0] == '-') usage();
+		else path = argv[i];
+	}
+	if(!path) usage();
+
+	division = readMidiFile(path);
+	if(!division) return 1;
+
+	hostSpiHook = spiCapture;
+
+	init();
+	stdout = out;
+	spiDrain();
+	uint32_t startWrites = evWrites; // start up (the first patch) isn't an event
+	uint32_t startBytes = evBytes;
+	evWrites = 0;
+	evBytes = 0;
+	evFrames = 0;
+
+	nextOvf = TIMER1_CYCLES;
+	nextSoft = TIMER0_CYCLES;
+	base = now;
+
+	for(uint32_t i = 0; i < eventCount; i++){
+		struct Event* e = &events[i];
+
+		cycles += (double)(e->tick - lastTick) * tempo * (F_CPU / 1000000UL) / division;
+		lastTick = e->tick;
+
+		if(!e->len){
+			tempo = e->tempo;
+			continue;
+		}
+
+		// a message can't start before the one before it is done coming in
+		uint64_t t = base + (uint64_t)cycles;
+		if(t > now) advance(t);
+
+		play(e);
+	}
+
+	// let the control ticks finish whatever's still going (releases, pending program changes)
+	advance(now + 16*TIMER1_CYCLES);
+
+	// the firmware's SPI clock: fosc/4, /16, /64, /128, doubled by SPI2X
+	static const uint8_t spiDividers[4] = {4, 16, 64, 128};
+	double spiDivider = spiDividers[SPCR & 0x03];
+	if(SPSR & (1<<SPI2X)) spiDivider /= 2;
+	double spiByteUs = (8*spiDivider + SPI_BYTE_GAP) / (F_CPU / 1000000.0);
+
+	printf("%s: %lu events, %.1f s, SPI fosc/%g (%.2f us/byte), YM2612 write %.1f us\n\n", path, (unsigned long)eventCount,
+		(double)(now - base) / F_CPU, spiDivider, spiByteUs, ymWriteUs);
+	printf("start up: %lu writes, %lu bytes\n\n", (unsigned long)startWrites, (unsigned long)startBytes);
+	printf("%-11s %7s %8s %8s %8s %7s %7s %7s %9s %9s\n", "event", "count", "writes", "bytes", "frames", "wr/ev", "max wr", "max by",
+		"spi us/ev", "ym us/ev");
+
+	struct Stats total = {0};
+
+	for(uint8_t k = 0; k < EV_KINDS; k++){
+		struct Stats* s = &stats[k];
+		double n = s->count ? s->count : 1;
+
+		printf("%-11s %7lu %8lu %8lu %8lu %7.2f %7lu %7lu %9.1f %9.1f\n", evNames[k], (unsigned long)s->count,
+			(unsigned long)s->writes, (unsigned long)s->bytes, (unsigned long)s->frames, s->writes / n,
+			(unsigned long)s->maxWrites, (unsigned long)s->maxBytes, (s->bytes * spiByteUs + s->frames * SPI_FRAME_GAP) / n, s->writes * ymWriteUs / n);
+
+		total.count += s->count;
+		total.writes += s->writes;
+		total.bytes += s->bytes;
+		total.frames += s->frames;
+	}
+
+	printf("%-11s %7lu %8lu %8lu %8lu\n", "total", (unsigned long)total.count, (unsigned long)total.writes,
+		(unsigned long)total.bytes, (unsigned long)total.frames);
+	printf("\nmodeled bus time: SPI %.1f ms, YM2612 %.1f ms\n", (total.bytes * spiByteUs + total.frames * SPI_FRAME_GAP) / 1000, total.writes * ymWriteUs / 1000);
+
+	return 0;
+}
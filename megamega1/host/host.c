@@ -0,0 +1,75 @@
+/*
+ * host.c
+ * the host side of host.h: the I/O registers, SPI capture, printf into the LCD framebuffer,
+ * and an HD44780 that isn't there
+ */
+
+#include <stdarg.h>
+
+#include "host.h"
+#include "../hd44780.h"
+#include "../lcd.h"
+
+volatile uint8_t PORTB, PORTC, PORTD, DDRB, DDRC, DDRD, PINB, PINC, PIND;
+volatile uint8_t SPCR, SPSR, SPDR;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0;
+volatile uint16_t UBRR0;
+volatile uint8_t PCMSK2, PCICR;
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t TCNT1, OCR1A, OCR1B;
+volatile uint8_t SREG;
+
+void (*hostSpiHook)(uint8_t b);
+
+// a byte goes out to the slave: it's done right away, so polling SPIF never waits
+// what comes back is the status of a slave that hasn't lost anything (see spiStatus() in ym2612c.c)
+void hostSpiSend(uint8_t b){
+	SPDR = 0xF0;
+	SPSR |= (1<<SPIF);
+
+	if(hostSpiHook) hostSpiHook(b);
+}
+
+// printf_P: avr-libc's %S (string in flash) is just %s here, everything else is the same
+int hostPrintf(const char* fmt, ...){
+	char hostFmt[64];
+	char out[64];
+	va_list args;
+	int len;
+
+	strncpy(hostFmt, fmt, sizeof(hostFmt) - 1);
+	hostFmt[sizeof(hostFmt) - 1] = 0;
+	for(char* c = hostFmt; *c; c++){
+		if(c[0] == '%' && c[1] == 'S') c[1] = 's';
+	}
+
+	va_start(args, fmt);
+	len = vsnprintf(out, sizeof(out), hostFmt, args);
+	va_end(args);
+
+	for(char* c = out; *c; c++) lcd_fb_putchar(*c, NULL);
+
+	return len;
+}
+
+// no LCD, lcd.c can talk to this all it wants
+void hd44780_outbyte(uint8_t b, uint8_t rs){
+	(void)b;
+	(void)rs;
+}
+
+uint8_t hd44780_inbyte(uint8_t rs){
+	(void)rs;
+	return 0;
+}
+
+void hd44780_wait_ready(bool islong){
+	(void)islong;
+}
+
+void hd44780_init(void){
+}
+
+void hd44780_powerdown(void){
+}
@@ -0,0 +1,120 @@
+/*
+ * host.h
+ * stand-ins for the avr-libc headers, so the megamega1 firmware logic builds natively (gcc -DHOST)
+ * for the benchmark harness in bench.c - included by hal.h instead of the AVR headers
+ *
+ * the I/O registers are plain variables (host.c), ISRs are plain functions the harness calls when their
+ * interrupt would have fired, and there's nothing to disable so cli()/sei() do nothing.  flash and EEPROM
+ * are just RAM.  every byte the firmware sends over SPI goes to hostSpiSend(), which hands it to hostSpiHook
+ */
+
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// I/O registers (only the ones megamega1 uses)
+extern volatile uint8_t PORTB, PORTC, PORTD, DDRB, DDRC, DDRD, PINB, PINC, PIND;
+extern volatile uint8_t SPCR, SPSR, SPDR;
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0;
+extern volatile uint16_t UBRR0;
+extern volatile uint8_t PCMSK2, PCICR;
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B;
+extern volatile uint8_t SREG;
+
+// register bits
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+
+#define SPR0 0
+#define SPR1 1
+#define MSTR 4
+#define SPE 6
+#define SPIE 7
+#define SPI2X 0
+#define SPIF 7
+
+#define RXEN0 4
+#define RXCIE0 7
+#define UCSZ02 2
+#define UCSZ00 1
+#define UCSZ01 2
+#define DOR0 3
+#define FE0 4
+
+#define PCINT17 1
+#define PCINT18 2
+#define PCINT19 3
+#define PCINT20 4
+#define PCIE2 2
+
+#define WGM01 1
+#define CS02 2
+#define OCIE0A 1
+
+#define CS10 0
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define TOV1 0
+#define OCF1B 2
+
+// interrupts
+#define ISR(vector, ...) void vector(void)
+#define sei()
+#define cli()
+
+// flash
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define memcpy_P memcpy
+#define printf_P hostPrintf
+
+int hostPrintf(const char* fmt, ...); // printf into the LCD framebuffer, %S is a flash string like avr-libc
+
+// EEPROM
+#define EEMEM
+#define eeprom_is_ready() 1
+#define eeprom_read_byte(addr) (*(const uint8_t*)(addr))
+#define eeprom_read_block(dst, src, len) memcpy((dst), (src), (len))
+#define eeprom_update_byte(addr, val) (*(uint8_t*)(addr) = (val))
+
+// delays don't wait for anything
+#define _delay_ms(ms)
+#define _delay_us(us)
+
+// stdio streams: the firmware's stream is never used, printf_P goes to the framebuffer itself
+#define _FDEV_SETUP_WRITE 0
+#define FDEV_SETUP_STREAM(put, get, flags) { 0 }
+
+// SPI: the byte is done as soon as it's sent (SPIF set), the harness counts the time it would have taken
+#define SPI_SEND(b) hostSpiSend(b)
+
+void hostSpiSend(uint8_t b);
+
+extern void (*hostSpiHook)(uint8_t b); // gets every byte sent
+
+#endif /* HOST_H_ */
@@ -24,13 +24,20 @@
 #include <stdint.h>
 #include <stdio.h>
 
-#include <avr/io.h>
-
-#include <util/delay.h>
+#include "hal.h"
 
 #include "hd44780.h"
 #include "lcd.h"
 
+#define LCD_COLS 16
+#define LCD_CELLS (2 * LCD_COLS)
+
+static char fb[LCD_CELLS]; // what should be on the screen, row 1 then row 2
+static char shown[LCD_CELLS]; // what is on the screen
+static uint8_t fb_pos; // where lcd_fb_putchar() puts the next character
+static uint8_t fb_scan; // where lcd_fb_update() looks for a changed cell first
+static uint8_t lcd_addr; // LCD's address counter, 0xFF if it isn't known
+
 /*
  * Setup the LCD controller.  First, call the hardware initialization
  * function, then adjust the display attributes we want.
@@ -59,6 +66,15 @@ lcd_init(void)
    */
   hd44780_outcmd(HD44780_DISPCTL(1, 0, 0));
   hd44780_wait_ready(false);
+
+  /*
+   * Display was just cleared, so the framebuffer starts out blank too.
+   */
+  for (uint8_t i = 0; i < LCD_CELLS; i++)
+    fb[i] = shown[i] = ' ';
+  fb_pos = 0;
+  fb_scan = 0;
+  lcd_addr = 0xFF;
 }
 
 /*
@@ -68,7 +84,7 @@ lcd_init(void)
 int
 lcd_putchar(char c, FILE *unused)
 {
-  static bool nl_seen = 0;
+  static uint8_t nl_seen = 0;
 
   if (nl_seen >= 2 && c != '\n')
     {
@@ -98,6 +114,8 @@ lcd_putchar(char c, FILE *unused)
       hd44780_outdata(c);
     }
 
+  lcd_addr = 0xFF; // printing this way goes around the framebuffer
+
   return 0;
 }
 
@@ -107,6 +125,7 @@ Returns the cursor to the first row first cell of the LCD
 void home(void){
   hd44780_wait_ready(true);
 	hd44780_outcmd(HD44780_DDADDR(0x00));
+	lcd_addr = 0x00;
 }
 
 /*
@@ -117,6 +136,8 @@ void clear(void){
 	hd44780_outcmd(HD44780_CLR);
 	hd44780_wait_ready(true);
 	hd44780_outcmd(HD44780_DDADDR(0));
+	for(uint8_t i = 0; i < LCD_CELLS; i++) shown[i] = ' ';
+	lcd_addr = 0x00;
 }
 
 /*
@@ -125,4 +146,70 @@ Puts the cursor at the start of the second row
 void row2(void){
 	hd44780_wait_ready(true);
 	hd44780_outcmd(HD44780_DDADDR(0x40));
+	lcd_addr = 0x40;
+}
+
+/*
+Puts a character in the framebuffer, anything past the end of a row is dropped
+*/
+int lcd_fb_putchar(char c, FILE *unused){
+	if(c == '\n'){
+		fb_pos = LCD_COLS;
+	} else if(fb_pos < LCD_CELLS){
+		fb[fb_pos++] = c;
+		if(fb_pos == LCD_COLS) fb_pos = LCD_CELLS; // row 1 is full, the rest goes nowhere until '\n'
+	}
+
+	return 0;
+}
+
+/*
+Blanks the framebuffer - nothing is sent until lcd_fb_update(), and then only the cells that change
+*/
+void lcd_fb_clear(void){
+	for(uint8_t i = 0; i < LCD_CELLS; i++) fb[i] = ' ';
+	fb_pos = 0;
+}
+
+/*
+Writes one changed cell to the LCD, so it takes at most one address command and one character
+the search starts after the last cell written, so a cell that keeps changing can't hold up the rest
+*/
+bool lcd_fb_update(void){
+	uint8_t i = fb_scan;
+	uint8_t addr;
+	char c;
+
+	for(uint8_t n = 0; n < LCD_CELLS; n++){
+		c = fb[i];
+
+		if(c != shown[i]){
+			addr = (i < LCD_COLS) ? i : 0x40 + i - LCD_COLS;
+
+			if(addr != lcd_addr){ // consecutive cells don't need the address set again
+				hd44780_wait_ready(false); // only clear and home need the long wait
+				hd44780_outcmd(HD44780_DDADDR(addr));
+			}
+
+			hd44780_wait_ready(false);
+			hd44780_outdata(c);
+
+			shown[i] = c; // what was actually sent, if fb[i] changed since it gets picked up next time
+			lcd_addr = addr + 1;
+			fb_scan = (i + 1 == LCD_CELLS) ? 0 : i + 1;
+
+			return true;
+		}
+
+		if(++i == LCD_CELLS) i = 0;
+	}
+
+	return false;
+}
+
+/*
+Writes every changed cell, for when the screen has to be right before moving on (startup)
+*/
+void lcd_fb_flush(void){
+	while(lcd_fb_update());
 }
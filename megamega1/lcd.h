@@ -43,3 +43,30 @@ void clear(void);
 Puts the cursor on the second row 
 */
 void row2(void);
+
+/*
+Framebuffer: printing goes into a 2x16 copy of the screen in RAM
+and lcd_fb_update() sends the cells that changed, one at a time,
+so nothing has to wait on the LCD while printing
+*/
+
+/*
+Send one character to the framebuffer, '\n' moves to the second row.
+For use with FDEV_SETUP_STREAM like lcd_putchar
+*/
+int	lcd_fb_putchar(char c, FILE *stream);
+
+/*
+Fills the framebuffer with spaces and moves to the first row first cell
+*/
+void lcd_fb_clear(void);
+
+/*
+Sends the next changed cell to the LCD, returns false if there wasn't one
+*/
+bool lcd_fb_update(void);
+
+/*
+Sends every changed cell to the LCD before returning
+*/
+void lcd_fb_flush(void);
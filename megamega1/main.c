@@ -8,8 +8,8 @@
  * this program is used in tandem with ym2612c.c to control the YM2612 for the
  * megamega2612 project
  *
- * the program uses SPI, pin change interrupts, USART RX interrupts, and timer1
- * overflow interrupts to change parameters and turn notes on in a YM2612 IC,
+ * the program uses SPI, pin change interrupts, USART RX interrupts, timer0 compare
+ * and timer1 overflow and compare interrupts to change parameters and turn notes on in a YM2612 IC,
  * which is controlled by the second ATmega328p, which receives the data over SPI
  * from the main controller
  * 
@@ -19,41 +19,38 @@
  * ATmega328p, connected via SPI, and of course the YM2612, which is not directly
  * connected to the ATmega for which this program is written
  *
- * parameters are arranged into 4 groups:
- *   group 1: preset patches and (in the future) extra options such as routing
- * of MIDI input (modulation, aftertouch, etc), drone mode, random mode, etc.
+ * parameters are arranged into 5 groups:
+ *   group 1: preset, user and random patches, saving, velocity, polyphony, bend range, MIDI channels, split, drums
  *   group 2: algorithm, feedback, frequency multiple*, detune*, total level*
  *   group 3: envelope parameters*
  *   group 4: LFO parameters: frequency, vibrato, amplitude modulation sensitivity,
- * AM on/off*
+ * AM on/off*, and the soft LFO: destination, rate, depth, fade in
+ *   group 5: modulation: where the mod wheel, aftertouch and velocity go, and how much
  *
  * *per operator parameters
  *
- * when input is received through the encoder and buttons (via PCINT on D1-D4),
- * the screen is updated and data is sent to the YM2612 over SPI
- * 
- * parameters are accessed and modified as follows, handled in the PCINT2 ISR:
+ * parameters are accessed and modified as follows:
  *  - to cycle through groups, press and RELEASE encoder (LEFT) button (move back) or standalone (RIGHT) button (move forward)
  *  - to cycle through parameters within groups, HOLD AND TURN the LEFT button
  *  - to change OPERATOR (4 available), HOLD the RIGHT button and TURN the encoder
  *  - to change the value of the currently selected parameter, just TURN the encoder left (decrement) or right (increment)
- * 
- * MIDI data handled by the program consists either of note on/off data or modulation data
- * (mod wheel, aftertouch, pitch bend, sustain).  routing of MIDI data is handled by the USART_RX ISR.
- * for note on/off MIDI data, the note() function is called, which does the following:
- *  - note on: find a channel that is not "on" or "scheduled" to be turned on, translate the incoming note
- * to a frequency and octave to be sent to the YM2612, "schedule" the selected channel to be turned on, and
- * assign the note on velocity to an array.  the velocity assigned can not be lower than minVel, which is defined by the user.
- *  - note off: find a channel that matches the note that is supposed to be turned off; schedule it to be turned off.
- * if MIDI sustain data comes in while notes are on, notes will be scheduled to be turned off, but won't be until sustain is released
+ *  - to save the current sound, go to "save to slot" in group 1, pick the slot, then HOLD one button and press and
+ * RELEASE the other (the same chord anywhere else in group 1 shows the hidden diagnostics pages)
+ *
+ * MIDI data handled by the program consists of note on/off, controllers (mod wheel, bank select, sustain),
+ * program change, aftertouch and pitch bend, and register streams sent as system exclusive messages
+ *
+ * the ISRs only record what happened (MIDI bytes, encoder detents and button releases, timer ticks) and the
+ * main loop does the work: midiParse() puts MIDI messages together and midiMessage() routes them to note() and
+ * the rest, uiUpdate() acts on the interface, controlTick() and softTick() run on the timer ticks, and the
+ * screen is printed into a framebuffer (lcd.h) that goes out to the LCD a character at a time.
+ * register writes go through sendreg() or a burst (burstBegin()), which drop anything the register shadow
+ * says the YM2612 already holds, and then into the SPI queue, which the SPI ISR sends in the background
  *
- * the TIMER1_OVF ISR is enabled so that when timer1 overflows, channels that are "scheduled" to be
- * turned off or on are made to be so, and their respective flags are changed to reflect that fact.
- * this function also handles the velocity by assigning a weighted average between incoming velocity
- * and the 'total level' of each operator as defined by the preset patch.  the weight is determined
- * by the global variable velSens
+ * main() is just init() and then mainLoop() over and over, so the host build (hal.h, host/) can run the same
+ * code without the AVR - host/bench.c replays MIDI files through it, build it with "make bench" in Debug/
  *
- * possible future developments are listed within the main while loop in lieu of any polling or other such business
+ * possible future developments are listed within mainLoop() in lieu of any polling or other such business
  */  
 /////////////////////////////////////////////////////////////////////////////
 
@@ -64,11 +61,7 @@
 // universal MIDI baud rate - used by UBRR0
 #define MIDI_BAUD 31250UL
 
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <avr/pgmspace.h>
-#include <util/delay.h>
-#include <avr/power.h>
+#include "hal.h" // avr-libc, or the host stand-ins for the benchmark harness
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -76,7 +69,7 @@
 #include "defines.h" // library for LCD
 #include "lcd.h"
 
-FILE lcd_str = FDEV_SETUP_STREAM(lcd_putchar, NULL, _FDEV_SETUP_WRITE); // for LCD
+FILE lcd_str = FDEV_SETUP_STREAM(lcd_fb_putchar, NULL, _FDEV_SETUP_WRITE); // for LCD, printf goes into the framebuffer
 
 // these are defined in the LCD 'defines.h' file
 // it might be redundant to define them here but i do it anyway for the sake of clarity
@@ -94,6 +87,14 @@ FILE lcd_str = FDEV_SETUP_STREAM(lcd_putchar, NULL, _FDEV_SETUP_WRITE); // for L
 #define ENC_A	PD3
 #define ENC_B	PD4
 
+// button releases closer together than this many timer1 overflows (4.1 ms each) are contact bounce
+#define DEBOUNCE_TICKS 5
+
+// encoder acceleration: detents closer together than these many timer1 overflows move 8, 4 or 2 steps
+#define ACCEL_8 3 // 12 ms
+#define ACCEL_4 6 // 25 ms
+#define ACCEL_2 12 // 50 ms
+
 // for future use - an indicator that a note is being pressed
 #define LED PB0 
 
@@ -104,10 +105,115 @@ FILE lcd_str = FDEV_SETUP_STREAM(lcd_putchar, NULL, _FDEV_SETUP_WRITE); // for L
 #define SS   PC4 // SS output is PC4 for convenience
 	
 #define MAX_PRESET 20
+
+// user patch slots in EEPROM (32 bytes each, the EEPROM is 1K)
+#define USER_SLOTS 16
+#define USER_MAGIC 0xA5 // UserSlot.used of a slot that has been saved to - erased EEPROM is 0xFF
+
+// noteVoice[] value for a note that isn't playing on any channel
+#define NO_VOICE 0x0F
+
+// midiPart() for a MIDI channel that isn't being listened to
+#define NO_PART 0xFF
+
+// drumMap[] entry for a note with no sample, and the range of notes it covers (GM drum notes)
+#define NO_SAMPLE 0xFF
+#define DRUM_FIRST 35
+#define DRUM_LAST 46
+
+// entries in the velocity curve, one per 2 velocity values
+#define VEL_STEPS 64
+
+// modulation sources (ym.modDest[]/ym.modDepth[] index)
+#define MOD_WHEEL 0
+#define MOD_AT 1
+#define MOD_VEL 2
+#define MOD_SOURCES 3
+
+// modulation destinations, same order as modDests[] - bit i of glb.modDirty is destination i
+#define MOD_OFF 0
+#define MOD_LFO 1
+#define MOD_VIBRATO 2
+#define MOD_AMS 3
+#define MOD_FEEDBACK 4
+#define MOD_BRIGHT 5
+#define MOD_DESTS 6
+
+// ISRs timed for glb.isrMax[], same order as isrNames[]
+#define ISR_MIDI 0
+#define ISR_SPI 1
+#define ISR_PCINT 2
+#define ISR_TIMER0 3
+#define ISR_TIMER1 4
+#define ISR_STREAM 5
+#define ISR_COUNT 6
+
+// keep the time an ISR took if it's the longest yet - start is TCNT1 from the top of the ISR
+// a macro so there's no function call, which would make the compiler save every register in the ISR
+#define ISR_TIME(n, start) do { uint16_t t = TCNT1 - (start); if(t > glb.isrMax[n]) glb.isrMax[n] = t; } while(0)
+
+// control ticks in a second, for the per second SPI counts: 16 MHz / 65536 = 244.1
+#define TICKS_PER_SEC 244
+
+// hidden diagnostics pages: latency, SPI rate, queue high-water marks, lost MIDI, frames the slave lost, then one per ISR
+#define DIAG_PAGES (5 + ISR_COUNT)
+
+// soft LFO destinations, same order as softDests[]
+#define SOFT_OFF 0
+#define SOFT_PITCH 1
+#define SOFT_LEVEL 2
+#define SOFT_FEEDBACK 3
+
+// most register writes the soft LFO gets per timer0 tick (4 ms), 18 bytes of SPI
+#define SOFT_BUDGET 6
+
+// held notes remembered in the mono modes
+#define MONO_STACK 8
+
+// MIDI receive ring buffer - must be a power of 2 so the indexes can wrap with a mask
+#define MIDI_QUEUE_SIZE 64
+#define MIDI_QUEUE_MASK (MIDI_QUEUE_SIZE - 1)
+
+// note ons waiting for their key on to go out over SPI, for the latency numbers - power of 2 as well
+#define LATENCY_SLOTS 4
+#define LATENCY_MASK (LATENCY_SLOTS - 1)
+
+// register stream (see streamByte()): system exclusive messages with the non-commercial ID carry chip writes and waits
+#define STREAM_ID 0x7D
+#define STREAM_CMD_WRITE 0x10 // | port << 2 | reg bit 7 << 1 | data bit 7, then reg and data (7 bits each)
+#define STREAM_CMD_WAIT 0x20 // then the number of samples, low 7 bits and high 7 bits
+#define STREAM_CMD_SHORT 0x30 // | n: wait n + 1 samples, like VGM's 0x7n
+#define STREAM_CMD_END 0x40 // stream is over, the patches go back on
+
+// stream queue entries: (port, reg, data) for a write, or one of these and two more bytes
+#define STREAM_WAIT 0xFF // low byte, high byte of a wait in samples
+#define STREAM_END 0xFE // unused, unused
+
+// stream queue, in entries - must be a power of 2 so the indexes can wrap with a mask
+#define STREAM_QUEUE_SIZE 32
+#define STREAM_QUEUE_MASK (STREAM_QUEUE_SIZE - 1)
+
+// stream waits are in samples at 44.1 kHz like VGM, one sample is this many 64ths of a CPU cycle
+#define STREAM_RATE 44100UL
+#define STREAM_STEP ((F_CPU * 64 + STREAM_RATE / 2) / STREAM_RATE)
+
+// the stream queue running out isn't the stream falling behind unless it's this late (cycles, 8 ms) when more comes in -
+// commands come in a ms or so apart over MIDI, so they're usually a little late already when they get to the queue
+#define STREAM_SLACK 131072L
+
+// most writes in one stream burst, they're put together on the stack of the timer1 compare B ISR
+#define STREAM_BURST 8
+
+// MIDI byte timestamps are clockNow() >> STAMP_SHIFT, kept to 16 bits: 32 us units, good for up to 2 s
+#define STAMP_SHIFT 9
 	
 ////////////// STRINGS USED BY THE LCD //////////////
 
-const char* patchNames[] = {
+// all in flash, printed with %S: the ATmega's 2K of SRAM is needed for the shadow, queues and patches
+// fixed width so the tables don't need a pointer per string, every string fits on one line of the LCD
+#define LCD_STR 17
+
+const char patchNames[][LCD_STR] PROGMEM = {
 	"ding dong piano",
 	"toxic sludge",
 	"wooden steel",
@@ -131,40 +237,50 @@ const char* patchNames[] = {
 	"ambient banjo"
 };
 
-const char* params[4][7] = {
+const char params[5][13][LCD_STR] PROGMEM = {
 	{
-		"preset patch","velocity sens","min velocity","polyphony"
+		"preset patch","velocity sens","min velocity","polyphony","bend range","user patch","save to slot",
+		"midi channel","split","part 2 channel","edit part","random patch","drum channel"
 	},{
 		"algorithm","feedback","freq mult","detune","level"
 	},{
 		"attack","decay","sust level","sust rate","release","rate scale","SSGEG"
 	},{
-		"LFO frequency","vibrato","AM sensitivity","AM"
+		"LFO frequency","vibrato","AM sensitivity","AM","soft LFO dest","soft LFO rate","soft LFO depth",
+		"soft LFO fade"
+	},{
+		"wheel dest","wheel depth","AT dest","AT depth","vel dest","vel depth"
 	}
 };
 
-const char* algorithms[] = {
+const char algorithms[][LCD_STR] PROGMEM = {
 	"1 > 2 > 3 > 4~", "1 & 2 > 3 > 4~",
 	"(2 > 3) & 1 > 4~", "(1 > 2) & 3 > 4~",
 	"1 > 2~, 3 > 4~", "1 > (2 & 3 & 4)~",
 	"1 > 3~, 2~, 4~", "1~, 2~, 3~, 4~"
 };
 
-const char* egTypes[] = {
+const char egTypes[][LCD_STR] PROGMEM = {
 	"OFF","forward loop", "one shot + low",
 	"forward+rev loop", "one shot + high",
 	"reverse loop", "reverse + high",
 	"rev+forward loop", "reverse + low"
 };
 
-const char* lfoFreqs[] = {
+const char lfoFreqs[][LCD_STR] PROGMEM = {
 	"OFF", "3.82 Hz", "5.33 Hz", "5.77 Hz", "6.11 Hz",
 	"6.60 Hz", "9.23 Hz", "46.11 Hz", "69.22 Hz"
 };
 
-const char* onOff[] = { "OFF", "ON" };
+const char onOff[][LCD_STR] PROGMEM = { "OFF", "ON" };
 	
-const char* playModes[] = { "polyphonic","mono retrig","mono legato" };
+const char playModes[][LCD_STR] PROGMEM = { "polyphonic","mono retrig","mono legato" };
+
+const char modDests[][LCD_STR] PROGMEM = { "OFF","LFO frequency","vibrato","AM sensitivity","feedback","brightness" };
+
+const char softDests[][LCD_STR] PROGMEM = { "OFF","pitch","level","feedback" };
+
+const char isrNames[][LCD_STR] PROGMEM = { "MIDI in","SPI","buttons","timer0","timer1","stream" };
 	
 /////////////////////////////////////////////////////
 
@@ -172,24 +288,136 @@ const char* playModes[] = { "polyphonic","mono retrig","mono legato" };
 // see https://www.plutiedev.com/ym2612-registers for more info
 const uint8_t chan[] = {0, 1, 2, 4, 5, 6};
 const uint8_t opOffset[] = {0, 0x08, 0x04, 0x0C};
-	
-// these will be used by random mode
-#define NUM_REGS 98
-
-// ALL registers used for programming YM2612
-const uint8_t regs[] = {
-  	0x22,				0xA0, 0xA4,	0xB0, 0xB4,	0x30, 0x38, 0x34, 0x3C,
-	0x28,				0xA1, 0xA5,	0xB1, 0xB5,	0x31, 0x39, 0x35, 0x3D,
-					0xA2, 0xA6,	0xB2, 0xB6,	0x32, 0x3A, 0x36, 0x3E,
-	// ^ global regs       		   ^ per channel regs ^          rest are per operator
-	0x40, 0x48, 0x44, 0x4C,		0x50, 0x58, 0x54, 0x5C,		0x60, 0x68, 0x64, 0x6C,
-	0x41, 0x49, 0x45, 0x4D,		0x51, 0x59, 0x55, 0x5D,		0x61, 0x69, 0x65, 0x6D,
-	0x42, 0x4A, 0x46, 0x4E,		0x52, 0x5A, 0x56, 0x5E,		0x62, 0x6A, 0x66, 0x6E,
-
-	0x70, 0x78, 0x74, 0x7C,		0x80, 0x88, 0x84, 0x8C,		0x90, 0x98, 0x94, 0x9C,		
-	0x71, 0x79, 0x75, 0x7D,		0x81, 0x89, 0x85, 0x8D,		0x91, 0x99, 0x95, 0x9D,		
-	0x72, 0x7A, 0x76, 0x7E,		0x82, 0x8A, 0x86, 0x8E,		0x92, 0x9A, 0x96, 0x9E,		
+
+// slave drum sample (ym2612c's samples.h: 0 kick, 1 snare, 2 hat) for GM drum notes DRUM_FIRST-DRUM_LAST
+const uint8_t drumMap[DRUM_LAST - DRUM_FIRST + 1] PROGMEM = {
+	0, 0, // acoustic and electric kick
+	1, 1, 1, 1, // side stick, snare, clap, electric snare
+	NO_SAMPLE, 2, NO_SAMPLE, 2, NO_SAMPLE, 2 // toms are left out, closed/pedal/open hat
+};
+
+// carrier operators for each algorithm, bit 0 is operator 1 - see algorithms[] above (the ones with ~)
+const uint8_t carrierMask[8] PROGMEM = {0x08, 0x08, 0x08, 0x08, 0x0A, 0x0E, 0x0E, 0x0F};
+	
+// YM2612 frequency for every MIDI note, ready to write: {A4 (block << 3 | F-number bits 10-8), A0 (F-number bits 7-0)}
+// F-number = note Hz * 144 * 2^20 / YM clock / 2^(block - 1), with the YM clocked at 8 MHz by the slave's OC1A
+// (16 MHz toggled every cycle), tuned to A4 = 440 Hz (note 69)
+// block is the MIDI octave (note / 12 - 1) kept within 0-7, which keeps the F-number between about 600 and 1200
+// for most of the range; notes above 116 are past the top of block 7 and just get the highest F-number
+const uint8_t noteTable[128][2] PROGMEM = {
+	{0x01, 0x35}, {0x01, 0x47}, {0x01, 0x5A}, {0x01, 0x6F}, {0x01, 0x85}, {0x01, 0x9C}, {0x01, 0xB4}, {0x01, 0xCE}, {0x01, 0xEA}, {0x02, 0x07}, {0x02, 0x26}, {0x02, 0x47}, // octave -1
+	{0x02, 0x69}, {0x02, 0x8E}, {0x02, 0xB5}, {0x02, 0xDE}, {0x03, 0x0A}, {0x03, 0x38}, {0x03, 0x69}, {0x03, 0x9D}, {0x03, 0xD4}, {0x04, 0x0E}, {0x04, 0x4C}, {0x04, 0x8D}, // octave 0
+	{0x0A, 0x69}, {0x0A, 0x8E}, {0x0A, 0xB5}, {0x0A, 0xDE}, {0x0B, 0x0A}, {0x0B, 0x38}, {0x0B, 0x69}, {0x0B, 0x9D}, {0x0B, 0xD4}, {0x0C, 0x0E}, {0x0C, 0x4C}, {0x0C, 0x8D}, // octave 1
+	{0x12, 0x69}, {0x12, 0x8E}, {0x12, 0xB5}, {0x12, 0xDE}, {0x13, 0x0A}, {0x13, 0x38}, {0x13, 0x69}, {0x13, 0x9D}, {0x13, 0xD4}, {0x14, 0x0E}, {0x14, 0x4C}, {0x14, 0x8D}, // octave 2
+	{0x1A, 0x69}, {0x1A, 0x8E}, {0x1A, 0xB5}, {0x1A, 0xDE}, {0x1B, 0x0A}, {0x1B, 0x38}, {0x1B, 0x69}, {0x1B, 0x9D}, {0x1B, 0xD4}, {0x1C, 0x0E}, {0x1C, 0x4C}, {0x1C, 0x8D}, // octave 3
+	{0x22, 0x69}, {0x22, 0x8E}, {0x22, 0xB5}, {0x22, 0xDE}, {0x23, 0x0A}, {0x23, 0x38}, {0x23, 0x69}, {0x23, 0x9D}, {0x23, 0xD4}, {0x24, 0x0E}, {0x24, 0x4C}, {0x24, 0x8D}, // octave 4
+	{0x2A, 0x69}, {0x2A, 0x8E}, {0x2A, 0xB5}, {0x2A, 0xDE}, {0x2B, 0x0A}, {0x2B, 0x38}, {0x2B, 0x69}, {0x2B, 0x9D}, {0x2B, 0xD4}, {0x2C, 0x0E}, {0x2C, 0x4C}, {0x2C, 0x8D}, // octave 5
+	{0x32, 0x69}, {0x32, 0x8E}, {0x32, 0xB5}, {0x32, 0xDE}, {0x33, 0x0A}, {0x33, 0x38}, {0x33, 0x69}, {0x33, 0x9D}, {0x33, 0xD4}, {0x34, 0x0E}, {0x34, 0x4C}, {0x34, 0x8D}, // octave 6
+	{0x3A, 0x69}, {0x3A, 0x8E}, {0x3A, 0xB5}, {0x3A, 0xDE}, {0x3B, 0x0A}, {0x3B, 0x38}, {0x3B, 0x69}, {0x3B, 0x9D}, {0x3B, 0xD4}, {0x3C, 0x0E}, {0x3C, 0x4C}, {0x3C, 0x8D}, // octave 7
+	{0x3C, 0xD3}, {0x3D, 0x1C}, {0x3D, 0x6A}, {0x3D, 0xBC}, {0x3E, 0x13}, {0x3E, 0x70}, {0x3E, 0xD2}, {0x3F, 0x3A}, {0x3F, 0xA8}, {0x3F, 0xFF}, {0x3F, 0xFF}, {0x3F, 0xFF}, // octave 8
+	{0x3F, 0xFF}, {0x3F, 0xFF}, {0x3F, 0xFF}, {0x3F, 0xFF}, {0x3F, 0xFF}, {0x3F, 0xFF}, {0x3F, 0xFF}, {0x3F, 0xFF}, // octave 9
+};
+
+// how far each modulation destination moves at full depth and a source at 127
+// brightness is in total level steps, so it only goes about half way
+const uint8_t modRange[MOD_DESTS] PROGMEM = {0, 8, 7, 3, 7, 64};
+
+// first quarter of a sine wave for the soft LFO, 256 steps per cycle: 127 * sin(i * 2pi / 256), i = 0-64
+// softSine() mirrors it for the rest
+const int8_t sineTable[65] PROGMEM = {
+	0, 3, 6, 9, 12, 16, 19, 22, 25, 28, 31, 34, 37, 40, 43, 46,
+	49, 51, 54, 57, 60, 63, 65, 68, 71, 73, 76, 78, 81, 83, 85, 88,
+	90, 92, 94, 96, 98, 100, 102, 104, 106, 107, 109, 111, 112, 113, 115, 116,
+	117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126, 126, 126, 127, 127, 127,
+	127
+};
+
+// frequency ratios for pitch bend, for 0-63 64ths of a semitone: 2^(n / (64 * 12)) * 32768
+// a bent F-number is the note's F-number from noteTable times one of these, shifted right 15
+const uint16_t bendRatio[64] PROGMEM = {
+	32768, 32798, 32827, 32857, 32887, 32916, 32946, 32976,
+	33005, 33035, 33065, 33095, 33125, 33155, 33185, 33215,
+	33245, 33275, 33305, 33335, 33365, 33395, 33425, 33455,
+	33486, 33516, 33546, 33576, 33607, 33637, 33667, 33698,
+	33728, 33759, 33789, 33820, 33850, 33881, 33911, 33942,
+	33973, 34003, 34034, 34065, 34095, 34126, 34157, 34188,
+	34219, 34250, 34281, 34312, 34343, 34374, 34405, 34436,
+	34467, 34498, 34529, 34560, 34591, 34623, 34654, 34685,
+};
+
+// one patch, stored exactly the way it gets written to the YM2612's registers
+// operator arrays are in operator order (0-3), the op offsets are added when the patch is loaded
+struct Patch {
+	uint8_t lfo; // 0x22: LFO on << 3 | LFO frequency
+	uint8_t algFb; // 0xB0: feedback << 3 | algorithm
+	uint8_t lfoSens; // 0xB4: pan L+R | AM sensitivity (tremolo) << 4 | FM sensitivity (vibrato)
+	uint8_t dtMul[4]; // 0x30: detune << 4 | frequency multiple
+	uint8_t tl[4]; // 0x40: total level (0 is loudest)
+	uint8_t rsAr[4]; // 0x50: rate scale << 6 | attack rate
+	uint8_t amD1r[4]; // 0x60: AM on << 7 | decay rate
+	uint8_t d2r[4]; // 0x70: sustain rate
+	uint8_t slRr[4]; // 0x80: sustain level << 4 | release rate
+	uint8_t ssgEg[4]; // 0x90: SSG-EG on << 3 | SSG-EG type
+};
+
+// a user patch slot - used is written last, so a slot only counts once the whole patch is in
+struct UserSlot {
+	struct Patch patch;
+	uint8_t used; // USER_MAGIC if saved to
+};
+
+struct UserSlot userSlots[USER_SLOTS] EEMEM;
+
+// preset patches in flash, same order as patchNames[]
+// adding a patch is just adding a line here and a name above (and bumping MAX_PRESET)
+const struct Patch presets[] PROGMEM = {
+	{0x00, 0x07, 0xC0, {0x0A, 0x48, 0x64, 0x32}, {0x40, 0x0A, 0x0A, 0x00}, {0x5F, 0x9F, 0x5F, 0x9F}, {0x08, 0x08, 0x08, 0x08}, {0x02, 0x02, 0x02, 0x02}, {0xFE, 0xFE, 0xFE, 0xFE}, {0x00, 0x00, 0x00, 0x00}}, // ding dong piano
+	{0x09, 0x23, 0xC4, {0x31, 0x3A, 0x32, 0x36}, {0x00, 0x00, 0x00, 0x00}, {0x5F, 0x5D, 0x53, 0x58}, {0x1B, 0x1F, 0x08, 0x00}, {0x02, 0x0F, 0x1F, 0x02}, {0x18, 0xAA, 0xF7, 0x28}, {0x00, 0x00, 0x00, 0x00}}, // toxic sludge
+	{0x00, 0x04, 0xC0, {0x0A, 0x48, 0x64, 0x32}, {0x64, 0x0F, 0x0F, 0x00}, {0x5F, 0x9F, 0x56, 0x9F}, {0x0F, 0x0F, 0x0F, 0x0A}, {0x02, 0x02, 0x02, 0x02}, {0xF8, 0xF8, 0xF8, 0xF5}, {0x00, 0x00, 0x00, 0x00}}, // wooden steel
+	{0x0A, 0x1D, 0xF0, {0x0A, 0x48, 0x66, 0x32}, {0x1B, 0x0A, 0x0A, 0x00}, {0x55, 0x85, 0x46, 0x9F}, {0x10, 0x08, 0x8F, 0x0A}, {0x02, 0x02, 0x02, 0x02}, {0x26, 0x8E, 0x2C, 0xF4}, {0x00, 0x00, 0x00, 0x00}}, // steel drum pad
+	{0x08, 0x30, 0xE6, {0x0A, 0x48, 0x61, 0x32}, {0x27, 0x0F, 0x0F, 0x00}, {0x91, 0x4E, 0x91, 0x57}, {0x8D, 0x8C, 0x8C, 0x09}, {0x02, 0x02, 0x02, 0x02}, {0xF9, 0xF9, 0xF9, 0x07}, {0x0A, 0x08, 0x0A, 0x00}}, // (un)naturhythm
+	{0x00, 0x2A, 0xC0, {0x61, 0x02, 0x67, 0x32}, {0x01, 0x1E, 0x15, 0x00}, {0x4F, 0x4C, 0x44, 0x55}, {0x04, 0x09, 0x05, 0x0A}, {0x00, 0x00, 0x00, 0x04}, {0x27, 0x57, 0x37, 0x37}, {0x00, 0x00, 0x00, 0x00}}, // reedy ripper
+	{0x00, 0x27, 0xC0, {0x14, 0x52, 0x41, 0x22}, {0x03, 0x0A, 0x07, 0x00}, {0x5F, 0x5F, 0x5F, 0x5F}, {0x0F, 0x08, 0x00, 0x13}, {0x02, 0x02, 0x1F, 0x0D}, {0xFE, 0xFE, 0xFE, 0xFE}, {0x00, 0x00, 0x00, 0x00}}, // lately who?
+	{0x00, 0x03, 0xC0, {0x04, 0x56, 0x63, 0x24}, {0x10, 0x30, 0x09, 0x00}, {0x94, 0x91, 0x5D, 0x9E}, {0x10, 0x0B, 0x15, 0x0E}, {0x02, 0x02, 0x02, 0x02}, {0xF6, 0xFE, 0xF5, 0xF6}, {0x00, 0x00, 0x00, 0x00}}, // tuned bounce
+	{0x00, 0x23, 0xC0, {0x24, 0x56, 0x67, 0x24}, {0x10, 0x0A, 0x09, 0x00}, {0x95, 0x89, 0x44, 0x9E}, {0x10, 0x0B, 0x0E, 0x0A}, {0x02, 0x02, 0x00, 0x02}, {0xF6, 0xFE, 0xF5, 0xF6}, {0x00, 0x00, 0x00, 0x00}}, // morph metal
+	{0x00, 0x2B, 0xC0, {0x12, 0x13, 0x42, 0x31}, {0x0B, 0x09, 0x08, 0x00}, {0x46, 0x48, 0x5F, 0x5F}, {0x06, 0x04, 0x0C, 0x07}, {0x00, 0x00, 0x00, 0x00}, {0x6B, 0x5B, 0x4B, 0x2B}, {0x00, 0x00, 0x00, 0x00}}, // get(s) nasty
+	{0x09, 0x2D, 0xE5, {0x22, 0x42, 0x62, 0x32}, {0x13, 0x0A, 0x03, 0x00}, {0x57, 0x99, 0x53, 0x98}, {0x06, 0x0F, 0x84, 0x05}, {0x02, 0x02, 0x02, 0x02}, {0xBB, 0xFE, 0xFC, 0xFD}, {0x00, 0x00, 0x00, 0x00}}, // flarp wobble
+	{0x0A, 0x34, 0xF2, {0x04, 0x65, 0x14, 0x34}, {0x0A, 0x0D, 0x0A, 0x00}, {0x5C, 0x49, 0x42, 0x4D}, {0x0F, 0x83, 0x08, 0x0B}, {0x02, 0x02, 0x02, 0x02}, {0xF8, 0xF8, 0xF7, 0xF8}, {0x00, 0x00, 0x00, 0x00}}, // pan flute
+	{0x0C, 0x15, 0xD0, {0x32, 0x32, 0x3A, 0x36}, {0x00, 0x17, 0x09, 0x00}, {0x84, 0x8F, 0x5F, 0x5F}, {0x06, 0x0C, 0x8C, 0x0A}, {0x00, 0x00, 0x00, 0x00}, {0xA6, 0xF7, 0x37, 0xF7}, {0x00, 0x08, 0x00, 0x00}}, // deceptive bass
+	{0x09, 0x2E, 0xE0, {0x07, 0x23, 0x6E, 0x43}, {0x0E, 0x07, 0x02, 0x09}, {0x5F, 0x5F, 0x46, 0x5F}, {0x09, 0x08, 0x89, 0x08}, {0x00, 0x00, 0x00, 0x00}, {0x45, 0x47, 0x47, 0x47}, {0x00, 0x00, 0x00, 0x00}}, // jagged EP
+	{0x0A, 0x2D, 0xE0, {0x31, 0x31, 0x34, 0x32}, {0x07, 0x07, 0x07, 0x00}, {0x44, 0x43, 0x4B, 0x47}, {0x01, 0x85, 0x17, 0x03}, {0x18, 0x00, 0x00, 0x00}, {0xF6, 0xC8, 0xF8, 0x58}, {0x00, 0x00, 0x08, 0x00}}, // all consuming
+	{0x00, 0x07, 0xC0, {0x32, 0x32, 0x32, 0x32}, {0x7F, 0x7F, 0x7F, 0x00}, {0x1F, 0x1F, 0x1F, 0x1F}, {0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x00, 0x00}, {0x0F, 0x0F, 0x0F, 0x0F}, {0x00, 0x00, 0x00, 0x00}}, // one operator
+	{0x00, 0x01, 0xC0, {0x0A, 0x48, 0x64, 0x32}, {0x64, 0x0F, 0x0F, 0x00}, {0x4D, 0x95, 0x4B, 0x9F}, {0x0F, 0x1F, 0x02, 0x06}, {0x02, 0x02, 0x02, 0x02}, {0xF8, 0xF8, 0xF8, 0xF5}, {0x00, 0x00, 0x00, 0x00}}, // squelchy
+	{0x00, 0x26, 0xC0, {0x3A, 0x31, 0x31, 0x31}, {0x07, 0x07, 0x07, 0x00}, {0x5F, 0x5F, 0x5F, 0x5F}, {0x07, 0x0C, 0x06, 0x12}, {0x00, 0x00, 0x00, 0x00}, {0xF7, 0xF7, 0xF9, 0xF6}, {0x00, 0x00, 0x00, 0x00}}, // ugly bell
+	{0x08, 0x22, 0xD0, {0x02, 0x36, 0x68, 0x34}, {0x07, 0x10, 0x16, 0x02}, {0x51, 0x88, 0x9F, 0x11}, {0x07, 0x88, 0x89, 0x00}, {0x07, 0x08, 0x04, 0x00}, {0xF6, 0xF7, 0x77, 0x36}, {0x00, 0x00, 0x0E, 0x00}}, // moving electric
+	{0x08, 0x2D, 0xE0, {0x54, 0x22, 0x4A, 0x32}, {0x0E, 0x0D, 0x12, 0x00}, {0x1F, 0x88, 0x4A, 0x1F}, {0x08, 0x87, 0x05, 0x04}, {0x00, 0x00, 0x00, 0x00}, {0xF8, 0xF8, 0xF6, 0xF6}, {0x00, 0x00, 0x0A, 0x00}}, // wurly slow dance
+	{0x00, 0x24, 0xC0, {0x34, 0x23, 0x47, 0x32}, {0x16, 0x0B, 0x19, 0x00}, {0x0D, 0x1F, 0x11, 0x1F}, {0x0B, 0x0A, 0x0E, 0x0C}, {0x07, 0x08, 0x08, 0x0A}, {0x86, 0xF6, 0xF6, 0xF6}, {0x0F, 0x00, 0x00, 0x00}}, // ambient banjo
 };
+
+// register shadow: the last value sent to every YM2612 register on both ports, so a write
+// that wouldn't change anything never goes out over SPI
+// the YM2612 only has registers between 0x21 and 0xB6, so only 0x20-0xBF is shadowed
+// (160 bytes per port instead of 256 - the ATmega only has 2K of SRAM to go around)
+#define SHADOW_BASE 0x20
+#define SHADOW_SIZE 0xA0
+
+// SPI transmit queue - must be a power of 2 so the indexes can wrap with a mask
+#define SPI_QUEUE_SIZE 128
+#define SPI_QUEUE_MASK (SPI_QUEUE_SIZE - 1)
+
+// SPI frame headers (same definitions in ym2612c.c) - a first byte below 0x80 is the flag of a single 3 byte write
+// a broadcast makes a parameter change one 4 byte frame instead of 6 separate writes, and a patch one burst
+// SS stays low for a whole frame, and the slave starts over at a header whenever SS changes, so a lost or extra
+// byte only spoils the frame it was in
+#define FRAME_BURST 0x80 // | flag: count, then count (reg, data) pairs for the port(s) in flag
+#define FRAME_BCAST 0xC0 // count, then count (reg, data) pairs, each written to channels 1-6
+#define FRAME_DAC 0xE0 // sample number, velocity: a drum sample through the slave's DAC, always 3 bytes
+#define SPI_FRAME_GAP 2 // us SS stays high between frames, so the slave sees it before the next byte comes in
+#define BURST_MAX 32 // most (reg, data) pairs in one burst, the slave doesn't care but the SPI queue does
+
+// what the slave sends back while a frame's header goes out: how many frames it has lost, 4 bits in the low nibble
+// and the same inverted in the high one (same as spiStatus() in ym2612c.c) - anything else isn't a status
+#define SLAVE_STATUS_OK(b) ((((b) >> 4 ^ (b)) & 0x0F) == 0x0F)
 	
 // global variables
 struct GlobalVars {
@@ -200,73 +428,220 @@ struct GlobalVars {
 	volatile uint8_t BTN_R_old;
 	
 	volatile bool chgGrp;
-	
-	// midi
-	volatile int midiBuf[128];
-	int midiIndex;
-	volatile uint8_t msgStart;
-	volatile uint8_t midiStatus;
-	
-	// other
-	volatile uint8_t sreg;
+	uint8_t btnTime; // low byte of clockHigh at the last button release that counted (PCINT2 ISR only)
+	
+	// interface events, added up by the PCINT2 ISR until uiUpdate() takes them
+	volatile int8_t uiGroup; // group changes (button releases)
+	volatile int8_t uiOp; // operator changes (turns with the right button held)
+	volatile int8_t uiCurrent; // parameter changes (turns with the left button held)
+	volatile int8_t uiValue; // value changes (turns with no button held)
+	volatile int8_t uiAccel; // the same with acceleration, for wide-range parameters
+	volatile bool uiSave; // one button released while the other is held
+	bool chord; // PCINT2 ISR: that happened, ignore releases until both buttons are up
+	uint8_t encTime; // low byte of clockHigh at the last value detent (PCINT2 ISR only)
+	int8_t encDir; // direction of the last value detent, 1 or -1 (PCINT2 ISR only)
+	
+	// midi: bytes are added at midiHead by the USART_RX ISR only and taken from midiTail by the main loop only,
+	// so neither side needs to disable interrupts
+	volatile uint8_t midiBuf[MIDI_QUEUE_SIZE];
+	volatile uint8_t midiHead;
+	volatile uint8_t midiTail;
+	volatile uint8_t midiDropped; // bytes lost because the buffer was full
+	volatile uint16_t midiTime[MIDI_QUEUE_SIZE]; // when each byte in midiBuf came in (clockStamp())
+	uint16_t msgTime; // when the last byte of the message being acted on came in
+	
+	// timing: timer1 overflows, the top half of clockNow()
+	volatile uint16_t clockHigh;
+	uint8_t tickLast; // low byte of clockHigh at the last control tick (main loop only)
+	
+	// MIDI in to the last byte of the key on frame going out, in clockStamp() units
+	// a note on waits in latencyMark/latencyStart until spiTail gets to the end of its frames (SPI ISR)
+	volatile uint8_t latencyMark[LATENCY_SLOTS]; // spiHead right after the note on's frames were queued
+	volatile uint16_t latencyStart[LATENCY_SLOTS]; // msgTime of the note on
+	volatile uint8_t latencyHead; // added by the main loop only
+	volatile uint8_t latencyTail; // taken by the SPI ISR (or spiQueue() polling) only
+	uint16_t latency; // last note on
+	uint16_t latencyMin; // best since the diagnostics were cleared
+	uint32_t latencyAvg; // running average of the last 8 or so, times 8
+	uint16_t latencyMax; // worst since the diagnostics were cleared
+	
+	// diagnostics, shown on the hidden page (printToLCD(16))
+	uint16_t isrMax[ISR_COUNT]; // longest time in each ISR, in cycles
+	uint16_t spiFrames; // frames/bytes queued this second so far
+	uint16_t spiBytes;
+	uint16_t spiFrameRate; // and in the last whole second
+	uint16_t spiByteRate;
+	uint8_t secTicks; // control ticks into this second
+	uint8_t spiHigh; // most bytes that have been waiting in the SPI queue
+	volatile uint8_t midiHigh; // most bytes that have been waiting in the MIDI buffer
+	volatile uint8_t midiOverrun; // bytes the UART lost because the last one wasn't read in time (DOR0)
+	volatile uint8_t midiFrameErr; // bytes with a bad stop bit (FE0), thrown away
+	
+	// parser state (main loop only)
+	uint8_t midiStatus; // running status - last channel status byte, 0 if there isn't one
+	uint8_t midiData[2]; // data bytes of the message being received
+	uint8_t midiCount; // how many data bytes of it have come in
+	bool midiSysex; // inside a system exclusive message
+	bool streamSysex; // and it's a register stream (STREAM_ID)
+	
+	// register stream: entries are added at streamHead by the main loop only and played from streamTail by
+	// streamRun() (timer1 compare B ISR), 3 bytes each (see STREAM_WAIT)
+	volatile uint8_t streamBuf[STREAM_QUEUE_SIZE][3];
+	volatile uint8_t streamHead;
+	volatile uint8_t streamTail;
+	uint8_t streamCmd[3]; // stream command being received
+	uint8_t streamCount; // how many bytes of it have come in
+	bool streamOn; // a stream has the chip, channel messages are ignored
+	volatile bool streamEnded; // streamRun() got to the end, the main loop puts the patches back
+	uint32_t streamDue; // clockNow() when the next entry is due
+	uint8_t streamFrac; // and the 64ths of a cycle left over from the waits
+	
+	// register shadow for port 0 (channels 1-3 + global regs) and port 1 (channels 4-6)
+	// a register's valid bit is only set once it has actually been written since power up
+	uint8_t shadow[2][SHADOW_SIZE];
+	uint8_t shadowValid[2][SHADOW_SIZE/8];
+	
+	// SPI transmit queue: bytes are added at spiHead and sent from spiTail by the SPI_STC ISR
+	volatile uint8_t spiBuf[SPI_QUEUE_SIZE];
+	volatile uint8_t spiHead;
+	volatile uint8_t spiTail;
+	volatile bool spiBusy; // a byte is currently being shifted out
+	uint8_t spiLeft; // bytes still to send in the frame being sent, after the one being shifted out now (SPI ISR/spiQueue() only)
+	bool spiFirst; // the byte being shifted out is a header, so what comes back is the slave's status (same)
+	uint8_t slaveLast; // lost frame count (4 bits) from the last status
+	volatile uint8_t slaveLost; // frames the slave lost since the diagnostics were cleared
+	
+	// user patch being saved by eepromTask(), a byte at a time
+	struct UserSlot saveBuf;
+	uint8_t saveSlot;
+	uint8_t saveNext; // next byte of saveBuf to write, sizeof(struct UserSlot) when there's nothing to do
+	
+	// current patch of each part: [0] is channels 1-3, or all 6 when split is off, [1] is channels 4-6
+	// the one being edited is kept up to date from the ym values by uiUpdate()
+	struct Patch parts[2];
+	
+	// modulation: source amounts (0-127) and the destinations that need modApply() on a control tick
+	uint8_t modSrc[MOD_SOURCES]; // [MOD_VEL] is the last note on's, for the LFO (channels use their own)
+	uint8_t modDirty;
+	uint8_t modNext; // destination controlTick() did last, so they take turns
+	
+	// soft LFO: timer0 compare matches (250 Hz), and each channel's phase (8.8 fixed point, 256 steps per cycle),
+	// fade in (0-255) and current pitch offset (64ths of a semitone)
+	volatile uint8_t softTicks;
+	uint8_t softLast; // softTicks at the last softTick() (main loop only)
+	uint16_t softPhase[6];
+	uint8_t softFade[6];
+	int8_t softPitch[6];
+	uint8_t softVoice; // channel softTick() goes to first, so they get turns when the budget runs out
+	
+	// patches from MIDI program changes, waiting for pendingLoad() - one per part, so a program change for
+	// one part doesn't lose the other's
+	struct Patch pending[2];
+	uint8_t pendingValid; // bit p is set when part p has one waiting
+	uint8_t bankMsb; // bank select, CC0
+	uint8_t bankLsb; // CC32
+	
+	uint16_t randState; // xorshift state for randomPatch(), never 0
+	
+	// burst frame being put together by burstBegin()/burstAdd()/burstEnd()
+	// there's only one of these, so bursts are only built from one place at a time (writeToYM() and preset changes)
+	uint8_t burst[2 + 2*BURST_MAX];
+	uint8_t burstCount;
+	bool burstOpen;
 };
 
 struct GlobalVars glb;
 
+// every parameter fits in 8 bits (the widest is detune at -3 to 3 or a 7 bit level), so they're all int8_t:
+// half the SRAM of int, and the AVR does 8 bit arithmetic in one instruction
+// (no bitfields, since the interface points ym.value at the parameter being edited)
 struct Parameters {
-	int op; // current operator value
-	int group; // current group value
-	int current; // current parameter selected within current group
-	int* value; // value of currently selected parameter
+	int8_t op; // current operator value
+	int8_t group; // current group value
+	int8_t current; // current parameter selected within current group
+	int8_t* value; // value of currently selected parameter
 	
-	// pitch etc (updated from USART_RX ISR)
+	// pitch etc (updated by the MIDI parser)
 	volatile uint8_t freq[6][2]; // freqs to be loaded into high (A4) and low (A0) registers for all 6 channels
 	volatile uint8_t notesOn[6][3]; // note value for each channel, whether it *should* be on, and whether it *is* on
-	volatile int timeOn[6]; // count how long each note has been held, turn off note that has been held the longest when reaching 6 notes
-	volatile int vel[6];
-	bool sustain;
+	volatile uint8_t voiceFree; // bit i is set when channel i is neither on nor waiting to be turned on
+	volatile uint8_t voiceAge[6]; // channels in order of their last note on/off, [0] is the oldest - used for stealing
+	volatile uint8_t noteVoice[64]; // channel playing each MIDI note (NO_VOICE if none), 2 notes per byte: even note in the low nibble
+	volatile uint8_t monoStack[MONO_STACK]; // held notes in mono modes, oldest first - the last one is playing
+	volatile uint8_t monoCount;
+	volatile uint8_t vel[6];
+	uint8_t velCurve[VEL_STEPS]; // carrier attenuation for each velocity (velocity >> 1), from velCurveBuild()
+	uint8_t carriers; // carrierMask[] for the current algorithm
+	bool sustain; // pedal is down
+	uint8_t sustained; // bit i is set when channel i's key is up but it's still on because of the pedal
+	volatile int16_t bend; // pitch bend from -8192 to 8191, 0 is centered
+	volatile bool bendChanged; // channels need to be re-tuned on the next control tick
 	
 	// group 0
-	int patchNum;
+	int8_t patchNum;
 	char* patchName;
-	int velSens;
-	int minVel;
-	int polyphony;
-	
-	// for later
-	int* modWheel;
-	int* aftertouch;
-	int modIndex;
-	int atIndex;
+	int8_t velSens;
+	int8_t minVel;
+	int8_t polyphony;
+	int8_t bendRange; // semitones up/down at full pitch bend
+	int8_t userSlot; // user patch slot to recall
+	int8_t saveSlot; // user patch slot to save to
+	int8_t midiChan; // MIDI receive channel 1-16, 0 for all of them
+	int8_t split; // channels 1-3 and 4-6 are two separate parts
+	int8_t midiChan2; // part 2's MIDI channel, 1-16
+	int8_t part; // part being edited, 0 or 1
+	int8_t randNum; // random patches made so far (0-99), just so the screen changes each time
+	int8_t drumChan; // MIDI channel for the DAC drum samples, 1-16, 0 for none
+	int8_t diag; // diagnostics page, only reachable with the button chord
 	
 	// group 1
-	int algorithm;
-	int feedback;
-	int detune[4];
-	int multiple[4];
-	int totalLvl[4];
+	int8_t algorithm;
+	int8_t feedback;
+	int8_t detune[4];
+	int8_t multiple[4];
+	int8_t totalLvl[4];
 	
 	// group 2
-	int attack[4];
-	int decay[4];
-	int susLvl[4];
-	int susRate[4];
-	int release[4];
-	int rateScl[4];
-	int ssgeg[4];
+	int8_t attack[4];
+	int8_t decay[4];
+	int8_t susLvl[4];
+	int8_t susRate[4];
+	int8_t release[4];
+	int8_t rateScl[4];
+	int8_t ssgeg[4];
 	
 	// group 3
-	int lfoFreq;
-	int vibrato;
-	int tremolo;
-	int amOn[4];
+	int8_t lfoFreq;
+	int8_t vibrato;
+	int8_t tremolo;
+	int8_t amOn[4];
+	int8_t softDest; // SOFT_OFF-SOFT_FEEDBACK
+	int8_t softRate; // 0-127, about 0 to 16 Hz
+	int8_t softDepth; // 0-127
+	int8_t softFade; // 0-127, 0 is no fade, 127 takes about a second
+	
+	// group 4
+	int8_t modDest[MOD_SOURCES]; // MOD_OFF-MOD_BRIGHT
+	int8_t modDepth[MOD_SOURCES]; // -8 to 8
 };	
 
 struct Parameters ym;
 
-unsigned char SPIsend(unsigned char data); // send SPI data
+void spiQueue(const uint8_t* bytes, uint8_t len); // add bytes to the SPI transmit queue
+
+void spiNext(); // finish the byte that was just sent and start the next one in the queue
+
+void spiFrameStart(); // pull SS low and send the first byte of the frame at spiTail
+
+bool sendreg(uint8_t flag, uint8_t reg, uint8_t data); // send YM2612 data over SPI, false if the shadow dropped it
 
-void sendreg(uint8_t flag, uint8_t reg, uint8_t data); // send YM2612 data over SPI
+bool shadowCheck(uint8_t flag, uint8_t reg, uint8_t data); // check register shadow, true if write is needed
+
+void burstBegin(uint8_t header); // start collecting register writes into one burst frame
+
+void burstAdd(uint8_t reg, uint8_t data); // add a register write to the current burst
+
+void burstEnd(); // queue the finished burst frame
 
 // update YM2612 parameter registers for all 6 channels
 void writeToYM(uint8_t op, uint8_t val1, uint8_t val2, uint8_t baseReg, uint8_t bitShift1, uint8_t bitShift2,
@@ -275,37 +650,190 @@ bool multiOp, bool multiChannel, uint8_t options, uint8_t subValue1, uint8_t sub
 //void printToLCD(char param[17],int options); // update LCD
 void printToLCD(int options); // update LCD
 
-void minMaxValue(int* var, int min, int max); // restrict passed parameter within min/max values
+void minMaxValue(int8_t* var, int8_t min, int8_t max); // restrict passed parameter within min/max values
+
+void stepValue(int8_t* var, int8_t step, int8_t min, int8_t max); // add step to parameter, keeping it within min/max values
 
-// update all YM parameters at once
-void changeAllParams(int alg, int fb, int lfo, int vib, int trem,
-int mult0, int  mult1, int mult2, int mult3, int det0, int det1, int det2, int det3,
-int tl0, int tl1, int tl2, int tl3, int atk0, int atk1, int atk2, int atk3,
-int dcy0, int dcy1, int dcy2, int dcy3, int sl0, int sl1, int sl2, int sl3,
-int sr0, int sr1, int sr2, int sr3, int rel0, int rel1, int rel2, int rel3,
-int rs0, int rs1, int rs2, int rs3, int eg0, int eg1, int eg2, int eg3,
-int am0, int am1, int am2, int am3);
+void patchDecode(const struct Patch* patch); // set parameter values inside program from a patch
+
+void patchLoad(const struct Patch* patch, uint8_t part); // change all parameters of a part at once, inside program and in YM2612
+
+void patchEncode(struct Patch* patch); // make a patch out of the current parameter values
 
 void preset(); // load presets
 
-void changeGroup(); // select between 4 groups
+uint8_t randNext(uint8_t min, uint8_t max); // xorshift random number from min to max
+
+void randomPatch(); // make up a new patch and load it
+
+bool userEmpty(uint8_t slot); // user patch slot hasn't been saved to
+
+void userRecall(); // load the selected user patch
+
+void userSave(); // start saving the current sound to the selected user slot
+
+void eepromTask(); // write the next byte of a user patch being saved
+
+void programChange(uint8_t program, uint8_t part); // MIDI program change: get the patch ready to be loaded
+
+void pendingLoad(uint8_t part); // load the patch a program change got ready for a part
+
+bool notesHeld(uint8_t part); // any keys down in a part
+
+uint8_t partPort(uint8_t part); // sendreg() flag for a part's channels
+
+uint8_t partMask(uint8_t part); // channels that belong to a part
+
+uint8_t voicePart(uint8_t voice); // part a channel belongs to
+
+void partBurst(uint8_t part); // start a burst for a part's channels
+
+void chanAdd(uint8_t reg, uint8_t data); // add a per channel register write for every channel of the burst's part
+
+void partSelect(uint8_t part); // change which part is being edited
+
+void splitChange(); // split has been turned on or off
+
+void drumChange(); // drum channel turned on or off
+
+void drumNote(uint8_t noteIn, uint8_t velocity); // drum channel note on: play its sample
+
+uint8_t midiPart(uint8_t channel); // part a MIDI channel plays, NO_PART if it isn't listened to
+
+void changeGroup(); // select between 5 groups
 
 void changeCurrent(); // select parameter within groups
 
-void changeValue(); // update value of parameter on LCD and in YM2612
+void changeValue(int8_t step); // update value of parameter on LCD and in YM2612
+
+void uiUpdate(); // act on the interface events the PCINT2 ISR has recorded
+
+bool accelerated(); // does the selected parameter use encoder acceleration
+
+int8_t accelStep(int8_t dir, uint8_t now); // how far one value detent moves, from the time since the last one
+
+uint8_t max(uint8_t val1, uint8_t val2);
+
+void velCurveBuild(); // rebuild the velocity curve after velSens or minVel change
+
+void carriersUpdate(); // new algorithm: new carriers, and the old ones back to their patch levels
+
+void noteFreq(uint8_t noteIn, int16_t bendOffset, volatile uint8_t* freq); // get A4/A0 values for a (bent) note
+
+int16_t bendOffset(); // current pitch bend in 64ths of a semitone
+
+void note(uint8_t noteIn, uint8_t velocity, bool on, uint8_t part); // turn notes off/on
+
+void noteMono(uint8_t noteIn, uint8_t velocity, bool on); // note on/off in mono retrig/legato modes
+
+void monoPlay(uint8_t noteIn, bool legato); // change the note on the mono channel
+
+void notesReset(); // turn all channels off and forget every note
+
+void voiceOn(uint8_t voice); // turn a channel on with its note and velocity
+
+uint8_t voiceLevel(uint8_t voice, uint8_t extra); // write a channel's carrier levels for its velocity, made quieter by extra
+
+void voiceOff(uint8_t voice); // turn a channel off and free it
+
+void voiceRelease(uint8_t voice); // key up: turn a channel off, or leave it to the sustain pedal
+
+void sustainRelease(); // turn off every channel that was only still on because of sustain
+
+uint8_t sustainedGet(uint8_t noteIn, uint8_t part); // sustained channel of a part playing a note
+
+uint8_t voiceAlloc(uint8_t part); // pick a channel for a new note, stealing one if they're all in use
+
+void voiceTouch(uint8_t voice); // mark channel as the most recently used
+
+uint8_t noteVoiceGet(uint8_t noteIn); // channel playing a note
+
+void noteVoiceSet(uint8_t noteIn, uint8_t voice); // set channel playing a note
+
+uint8_t noteScan(uint8_t noteIn); // channel in part 2 playing a note
+
+void midiParse(); // parse the MIDI bytes that have come in
+
+void midiMessage(uint8_t status, uint8_t data1, uint8_t data2); // act on a complete MIDI message
+
+void streamByte(uint8_t data); // system exclusive data byte: put register stream commands together
+
+void streamBegin(); // a register stream is starting, the chip is the stream's until it ends
+
+void streamStop(); // the stream is over, put the patches back
+
+void streamCancel(); // the stream was abandoned: drop what's left of it and put the patches back
+
+void streamKick(); // start playing the stream queue if it isn't already
+
+void streamRun(); // play the stream entries that are due
+
+uint32_t clockNow(); // cycles since power up
+
+uint16_t clockStamp(); // short timestamp for MIDI bytes
+
+void latencyRecord(); // the message just acted on was a note on, time it until its key on is sent
+
+void latencyDone(uint16_t start); // a note on's key on is out, add it to the latency numbers
+
+void diagClear(); // start the diagnostics over
+
+void controlTick(); // periodic work, once per timer1 overflow
+
+void modMark(uint8_t dest); // a modulation destination needs to be brought up to date
+
+void modMarkAll(); // every destination something is routed to needs to be brought up to date
+
+int16_t modDelta(uint8_t dest, uint8_t vel); // how far the sources move a destination
+
+uint8_t modClamp(int16_t val, uint8_t max); // keep a modulated value within 0-max
+
+uint8_t modValue(uint8_t dest, uint8_t voice, uint8_t op); // modulated register value of a per channel destination
+
+void modApply(uint8_t dest); // write a modulation destination to every channel
 
-int max(int val1, int val2);
+void modSend(uint8_t reg, const uint8_t* vals, uint8_t mask); // write per channel values, as one broadcast if they're all the same
 
-void note(uint8_t noteIn, uint8_t velocity, bool on); // schedule notes to be turned off/on
+void softTick(uint8_t ticks); // soft LFO, once per timer0 tick
+
+int8_t softSine(uint8_t phase); // sine wave, -127 to 127, 256 steps per cycle
+
+uint8_t softWrite(uint8_t voice); // write the soft LFO to one channel, returns how many registers were written
+
+void softRestore(); // soft LFO is leaving its destination, put the patch values back
 
 ISR(USART_RX_vect); // midi data received
 
-ISR(TIMER1_OVF_vect); // turn on/off scheduled notes
+ISR(TIMER1_OVF_vect); // count timer1 overflows for clockNow()
+
+ISR(TIMER1_COMPB_vect); // register stream timing
+
+ISR(TIMER0_COMPA_vect); // count soft LFO ticks
+
+ISR(SPI_STC_vect); // SPI byte sent, send the next queued one
+
+ISR(PCINT2_vect); // pin change ISR for interface (encoder/buttons - D1-D4), records events for uiUpdate()
+
+void init(); // set up the hardware, the ym values and the first patch
 
-ISR(PCINT2_vect); // pin change ISR for interface (encoder/buttons - D1-D4)
+void mainLoop(); // one time around the main loop
 
+// the host build has its own main() (host/bench.c) that calls init() and mainLoop()
+#ifndef HOST
 int main(void) {	
+	init();
 	
+	sei(); // lets goooooooooo
+	
+    while (1) 
+    {		
+		mainLoop();
+	}
+}
+#endif
+
+// everything main() does before turning interrupts on
+void init(){
 	stdout = &lcd_str; // printf prints to LCD
 
 	lcd_init(); // initialize lcd
@@ -313,6 +841,7 @@ int main(void) {
 	// DDRs for SPI (B & C), LCD (B & C), and interface (D)
 	// note that PB2 (LCD_E) is the uC's SS pin - since it's set as output it shouldn't affect the SPI's functioning
 	DDRB |= (1<< LCD_RS) | (1<<LCD_E) | (1<<MOSI) | (1<<SCK) | (0<<MISO);
+	PORTB |= (1<<MISO); // pull-up, so MISO reads 0xFF (not a status) if nothing drives it
 	
 	// SS is PC4
 	DDRC |= (1<<LCD_D4) | (1<<LCD_D5) | (1<<LCD_D6) | (1<<LCD_D7) | (1<<SS);
@@ -321,7 +850,8 @@ int main(void) {
 	DDRD &= ~((1<<MIDI_IN) | (1<<BTN_L) | (1<<BTN_R) | (1<<ENC_A) | (1<<ENC_B)); 
 	
 	// initialize SPI for sending messages to mega2 to be transmitted to YM2612
-	SPCR = (1<<SPE) | (1<<MSTR) | (1<<SPR1); // SPI enable, master mode, divide clock by 64
+	SPCR = (1<<SPIE) | (1<<SPE) | (1<<MSTR) | (1<<SPR0); // SPI interrupt, SPI enable, master mode, divide clock by 16...
+	SPSR = (1<<SPI2X); // ...doubled, so 2 MHz (fosc/4 would be faster than the slave's ISR can read the bytes)
 	
 	// initialize USART for MIDI
 	UCSR0B = (1 << RXCIE0) | (1 << RXEN0) | (0 << UCSZ02); // enable RX interrupt, enable RX
@@ -337,9 +867,19 @@ int main(void) {
 	// initialize timer1
 	TCCR1A = 0; // no PWM, no compare, just counting up to 0xFFFF in "normal" mode
 	TCCR1B = (1<<CS10); // on, no prescale
-	TIMSK1 |= (1<<TOIE1); // enable timer1 overflow interrupt
+	TIMSK1 |= (1<<TOIE1); // enable timer1 overflow interrupt, counted for clockNow()
 	
 	TCNT1 = 0;
+	glb.clockHigh = 0;
+	glb.tickLast = 0;
+	
+	// initialize timer0: soft LFO tick, 16 MHz / 256 / 250 = 250 Hz
+	TCCR0A = (1<<WGM01); // CTC, clear at OCR0A
+	TCCR0B = (1<<CS02); // prescale 256
+	OCR0A = 249;
+	TIMSK0 |= (1<<OCIE0A); // enable timer0 compare A interrupt, counted for softTick()
+	glb.softTicks = 0;
+	glb.softLast = 0;
 	
 	// initialize stored interface pin values
 	glb.RPGpinOld = PIND & ((1<<ENC_A) | (1<<ENC_B));
@@ -356,73 +896,310 @@ int main(void) {
 	ym.value = &ym.patchNum;
 	
 	ym.sustain = false;
+	ym.sustained = 0;
+	
+	// all channels free, no notes playing
+	ym.voiceFree = 0x3F;
+	for(uint8_t i = 0; i < 6; i++) ym.voiceAge[i] = i;
+	memset((void*)ym.noteVoice, (NO_VOICE << 4) | NO_VOICE, sizeof(ym.noteVoice));
+	ym.monoCount = 0;
 	
 	ym.velSens = 2;
 	ym.minVel = 50;
+	velCurveBuild();
+	ym.bendRange = 2;
+	ym.bend = 0;
+	ym.userSlot = 0;
+	ym.saveSlot = 0;
+	ym.midiChan = 0; // omni
+	ym.split = 0;
+	ym.midiChan2 = 2;
+	ym.part = 0;
+	ym.randNum = 0;
+	ym.drumChan = 0;
+	glb.randState = 1; // the time of the first press gets mixed in, see randomPatch()
+	
+	// mod wheel speeds up the LFO and aftertouch adds vibrato, like they always have
+	ym.modDest[MOD_WHEEL] = MOD_LFO;
+	ym.modDepth[MOD_WHEEL] = 8;
+	ym.modDest[MOD_AT] = MOD_VIBRATO;
+	ym.modDepth[MOD_AT] = 8;
+	ym.modDest[MOD_VEL] = MOD_OFF;
+	ym.modDepth[MOD_VEL] = 4;
+	
+	ym.softDest = SOFT_OFF;
+	ym.softRate = 40; // about 1.7 Hz
+	ym.softDepth = 20;
+	ym.softFade = 0;
+	
+	glb.saveNext = sizeof(struct UserSlot); // not saving
+	
+	diagClear();
 	
 	// initialize MIDI buffer situation
-	glb.midiIndex = 0;
-	glb.msgStart = 0;
+	glb.midiHead = 0;
+	glb.midiTail = 0;
+	glb.midiStatus = 0;
+	glb.midiCount = 0;
+	glb.midiSysex = false;
+	glb.streamSysex = false;
+	
+	// no register stream
+	glb.streamHead = 0;
+	glb.streamTail = 0;
+	glb.streamOn = false;
+	glb.streamEnded = false;
+	
+	// SPI queue starts out empty
+	glb.spiHead = 0;
+	glb.spiTail = 0;
+	glb.latencyHead = 0;
+	glb.latencyTail = 0;
+	glb.spiBusy = false;
+	glb.spiLeft = 0;
+	glb.spiFirst = false;
+	glb.slaveLast = 0;
 	
 	// i'm cool
-	printf("Boney Circuitry\n  megamega2612");
+	printf_P(PSTR("Boney Circuitry\n  megamega2612"));
+	lcd_fb_flush(); // main loop isn't running yet
 	_delay_ms(1000);
 	
 	// show preset patch on startup
 	preset();
 	changeGroup();
+}
+
+// each of these only does a little bit of work if it has any, so nothing waits long for its turn
+void mainLoop(){
+	midiParse();
+	
+	// timer1 overflowed since last time around
+	if((uint8_t)glb.clockHigh != glb.tickLast){
+		glb.tickLast = (uint8_t)glb.clockHigh;
+		controlTick();
+	}
 	
-	sei(); // lets goooooooooo
+	// timer0 ticked since last time around, maybe more than once if the loop was busy
+	if(glb.softTicks != glb.softLast){
+		uint8_t ticks = glb.softTicks - glb.softLast;
+		glb.softLast += ticks;
+		softTick(ticks);
+	}
 	
-    while (1) 
-    {		
-		/*
-		TODO:
-			- set up way to change parameter selection for mod wheel & AT
-			- midi channel
-			- random sounds
-			- turn off oldest note when playing new note (past 6 channels)
-			- dont play notes lower than lowest oct/higher than highest
-			- velocity!!
-				- CHANGE MIN VELOCITY
-			- monophonic mode (legato/retrig)
-				- part of patch
-			- MIDI in LED
-			- pitch bend?
-			- poly AT?
-		*/
+	uiUpdate();
+	
+	eepromTask();
+	
+	// program change, between notes
+	for(uint8_t p = 0; p < 2; p++){
+		if((glb.pendingValid & (1<<p)) && !notesHeld(p)) pendingLoad(p);
 	}
+	
+	if(glb.streamEnded) streamStop(); // register stream is over
+	
+	lcd_fb_update(); // one changed character, if there is one
+	
+	/*
+	TODO:
+		- midi channel
+		- dont play notes lower than lowest oct/higher than highest
+		- velocity!!
+			- CHANGE MIN VELOCITY
+		- MIDI in LED
+		- poly AT?
+	*/
 }
 
 ////////////////////////////// FUNCTIONS ///////////////////////////////////
 
-// transmit data over the SPI lines
-unsigned char SPIsend(unsigned char data){
-	uint8_t readData;
-	
-	glb.sreg = SREG;
+// add a frame of bytes to the SPI transmit queue - the whole frame goes in at once so frames from
+// different ISRs can't get mixed together
+// if the queue is full, the bytes ahead are sent by polling SPIF until there's room, because the SPI ISR
+// can't run while interrupts are disabled in here (this only happens during big bursts like preset changes)
+void spiQueue(const uint8_t* bytes, uint8_t len){
+	uint8_t sreg = SREG;
 	cli();
+	
+	while((uint8_t)(SPI_QUEUE_SIZE - (uint8_t)(glb.spiHead - glb.spiTail)) < len){
+		if(SPSR & (1<<SPIF)) spiNext();
+	}
+	
+	for(uint8_t i = 0; i < len; i++){
+		glb.spiBuf[glb.spiHead & SPI_QUEUE_MASK] = bytes[i];
+		++glb.spiHead;
+	}
+	
+	++glb.spiFrames;
+	glb.spiBytes += len;
+	if((uint8_t)(glb.spiHead - glb.spiTail) > glb.spiHigh) glb.spiHigh = glb.spiHead - glb.spiTail;
+	
+	// if nothing is being sent, start sending - otherwise the ISR will get to this frame when it's done
+	if(!glb.spiBusy){
+		glb.spiBusy = true;
+		spiFrameStart();
+	}
+	
+	SREG = sreg;
+}
+
+// the byte at spiTail has been sent: send the rest of its frame with SS still low, or release SS at the end of the
+// frame and start the next one if there's more in the queue
+// called from the SPI ISR, or from spiQueue() when it has to wait for space
+// if it was a header, the byte that came back is the slave's status: when its lost frame count has moved, some
+// writes never got to the YM2612, so the shadow is forgotten and everything gets written again from here on
+void spiNext(){
+	uint8_t rData;
+	
+	rData = SPDR; // clears SPIF when polling
+	
+	if(glb.spiFirst){
+		glb.spiFirst = false;
+		
+		if(SLAVE_STATUS_OK(rData) && (rData & 0x0F) != glb.slaveLast){
+			glb.slaveLost += (rData - glb.slaveLast) & 0x0F;
+			glb.slaveLast = rData & 0x0F;
+			memset(glb.shadowValid, 0, sizeof(glb.shadowValid));
+		}
+	}
+	
+	++glb.spiTail;
+	
+	// the last byte of a note on's frames just went out
+	while(glb.latencyTail != glb.latencyHead && glb.spiTail == glb.latencyMark[glb.latencyTail & LATENCY_MASK]){
+		latencyDone(glb.latencyStart[glb.latencyTail & LATENCY_MASK]);
+		++glb.latencyTail;
+	}
+	
+	if(glb.spiLeft){
+		--glb.spiLeft;
+		SPI_SEND(glb.spiBuf[glb.spiTail & SPI_QUEUE_MASK]);
+		return;
+	}
+	
+	PORTC |= (1<<SS); // set SS, the frame is done
+	
+	if(glb.spiTail != glb.spiHead){
+		_delay_us(SPI_FRAME_GAP);
+		spiFrameStart();
+	} else {
+		glb.spiBusy = false;
+	}
+}
+
+// frames are always queued whole, so the length of a burst can be read from its count byte right away
+void spiFrameStart(){
+	uint8_t header = glb.spiBuf[glb.spiTail & SPI_QUEUE_MASK];
+	
+	if(header == FRAME_DAC){
+		glb.spiLeft = 2;
+	} else if(header & FRAME_BURST){
+		glb.spiLeft = 1 + 2*glb.spiBuf[(uint8_t)(glb.spiTail + 1) & SPI_QUEUE_MASK];
+	} else {
+		glb.spiLeft = 2;
+	}
+	
 	PORTC &= ~(1<<SS); // clear SS to signify sending data
-	_delay_us(3);
-	SPDR = data; // send byte
-	while(!(SPSR & (1<<SPIF))); // wait for SPI data transmission complete flag SPIF in SPSR
-	readData = SPDR;
-	PORTC |= (1<<SS); // set SS
-	glb.sreg = SREG;
-	return readData; // only used for testing
+	glb.spiFirst = true;
+	SPI_SEND(header);
 }
 
 // send first a flag signifying which set of 3 channels (1-3 (0), 4-6 (1), or all 6 (default)) will be written to in the slave ATmega
 // followed by the register to be written to, followed by the data to be written to that register
-void sendreg(uint8_t flag, uint8_t reg, uint8_t data){
-	unsigned char rData;
+// nothing is sent if the register shadow shows the YM2612 already holds the data
+// the frame is only queued here - it is sent in the background by the SPI ISR
+bool sendreg(uint8_t flag, uint8_t reg, uint8_t data){
+	uint8_t frame[3];
+	
+	if(!shadowCheck(flag, reg, data)) return false;
+	
+	frame[0] = flag;
+	frame[1] = reg;
+	frame[2] = data;
+	
+	spiQueue(frame, 3);
+	
+	return true;
+}
+
+// compare a register write against the shadow of the port(s) selected by flag (same meaning as in sendreg())
+// returns true if the register has to be written, updating the shadow on the way
+// key on/off (0x28), the timer/ch3 mode/DAC registers (0x24-0x2A) and all the frequency registers (0xA0-0xAE)
+// are never skipped, since writing them does something even when the value is the same: 0xA4-0xA6 (and 0xAC-0xAE)
+// aren't really per channel, they all go into one high byte latch per port, and the next 0xA0-0xA2 write takes
+// whatever is in it - so an A4 write has to go out before every A0 write, even if it's the channel's old value
+bool shadowCheck(uint8_t flag, uint8_t reg, uint8_t data){
+	uint8_t i;
+	uint8_t bit;
+	bool changed = false;
+	
+	if(reg < SHADOW_BASE || reg >= SHADOW_BASE + SHADOW_SIZE) return true;
+	if((reg >= 0x24 && reg <= 0x2A) || (reg >= 0xA0 && reg <= 0xAE)) return true;
+	
+	i = reg - SHADOW_BASE;
+	bit = 1 << (i & 0x07);
+	
+	for(uint8_t port = 0; port < 2; port++){
+		if(flag < 2 && flag != port) continue; // flag 0 or 1 is a single port, anything else is both
+		
+		if(!(glb.shadowValid[port][i>>3] & bit) || glb.shadow[port][i] != data){
+			glb.shadow[port][i] = data;
+			glb.shadowValid[port][i>>3] |= bit;
+			changed = true;
+		}
+	}
+	
+	return changed;
+}
+
+// start a burst frame - header is FRAME_BURST | flag (same flags as sendreg()) or FRAME_BCAST
+void burstBegin(uint8_t header){
+	glb.burst[0] = header;
+	glb.burstCount = 0;
+	glb.burstOpen = true;
+}
+
+// add a register write to the burst that's being put together, unless the shadow shows it wouldn't change anything
+// for a broadcast burst, reg is the channel 1 register and the write counts for channels 1-6
+void burstAdd(uint8_t reg, uint8_t data){
+	bool changed;
+	
+	if(glb.burst[0] == FRAME_BCAST){
+		changed = shadowCheck(2, reg, data);
+		changed |= shadowCheck(2, reg + 1, data);
+		changed |= shadowCheck(2, reg + 2, data);
+	} else {
+		changed = shadowCheck(glb.burst[0] & 0x03, reg, data);
+	}
+	
+	if(!changed) return;
+	
+	glb.burst[2 + 2*glb.burstCount] = reg;
+	glb.burst[3 + 2*glb.burstCount] = data;
+	++glb.burstCount;
+	
+	// full, send what's there and keep going in a new burst
+	if(glb.burstCount == BURST_MAX){
+		uint8_t header = glb.burst[0];
+		burstEnd();
+		burstBegin(header);
+	}
+}
+
+// queue the burst frame - nothing is sent if every write was already in the shadow,
+// and a burst of just one write to one port goes out as a normal 3 byte frame
+void burstEnd(){
+	glb.burstOpen = false;
 	
-	rData = SPIsend(flag);
-	_delay_us(10);
-	rData = SPIsend(reg);
-	_delay_us(10);
-	rData = SPIsend(data);
-	_delay_us(10);
+	if(glb.burstCount == 0) return;
+	
+	if(glb.burstCount == 1 && glb.burst[0] != FRAME_BCAST){
+		glb.burst[1] = glb.burst[0] & 0x03; // single write flag goes right before reg and data
+		spiQueue(&glb.burst[1], 3);
+	} else {
+		glb.burst[1] = glb.burstCount;
+		spiQueue(glb.burst, 2 + 2*glb.burstCount);
+	}
 }
 
 // send parameter data to slave ATmega to be written to YM2612
@@ -441,49 +1218,53 @@ bool multiOp, bool multiChannel, uint8_t options, uint8_t subValue1, uint8_t sub
 	}
 	
 	// most registers are written to on a channel-by-channel basis
-	// so first send flag 0 to write to channel 1, 2, 3 (0xX0, 0xX1, 0xX2, 0xX3 + op offset),
-	// then send flag 1 to write to channels 4, 5, 6 using the same values
+	// so the value is broadcast to channels 1, 2, 3 (0xX0, 0xX1, 0xX2 + op offset) on both ports,
+	// which writes the same value to all 6 channels in one SPI frame
+	// with split on, only the 3 channels of the part being edited are written
 	if(multiChannel){
-		for(int j = 0; j < 2; j++){
-			for(int i = 0; i < 3; i++){ // write same value to all 6 channels
-				switch(options){
-					case 0: // shared, neither register is reversed
-						dataToWrite = (val1 << bitShift1) + (val2 << bitShift2);
-						break;
-					case 1: // val 1 is reversed, val 2 is not
-						dataToWrite = ((subValue1 - val1) << bitShift1) + (val2 << bitShift2);
-						break;
-					case 2: // val 1 is not reverse, val 2 is
-						dataToWrite = (val1 << bitShift1) + ((subValue2 - val2) << bitShift2);
-						break;
-					case 3: // both vals reversed
-						dataToWrite = ((subValue1 - val1) << bitShift1) + ((subValue2 - val2) << bitShift2);
-						break;
-					case 4: // not shared, not reverse (SSGEG if 0, frequency A0)
-						dataToWrite = val1;
-						break;
-					case 5: // for detune & oct, which have a a min value of -3 (val1)
-						dataToWrite = ((val1 + 3) << bitShift1) + (val2 << bitShift2);
-						break;
-					case 6: // for detune & oct, which have a a min value of -3 (val2)
-						dataToWrite = (val1 << bitShift1) + ((val2 + 3) << bitShift2);
-						break;
-					case 7: // only sustain rate, which is both not shared AND reversed
-						dataToWrite = subValue1 - val1;
-						break;
-					case 8: // only for reg B4+ which has pan (always both L and R true)
-						dataToWrite = 0xC0 + (val1 << bitShift1) + (val2 << bitShift2);
-						break;
-					case 9: // not shared, but reverse (total lvl)
-						dataToWrite = subValue1 - val1;
-						break;
-					default:
-						dataToWrite = val1;
-						break;
-				}
-				
-				sendreg(j, regToWrite + i, dataToWrite); // write
-			}
+		switch(options){
+			case 0: // shared, neither register is reversed
+				dataToWrite = (val1 << bitShift1) + (val2 << bitShift2);
+				break;
+			case 1: // val 1 is reversed, val 2 is not
+				dataToWrite = ((subValue1 - val1) << bitShift1) + (val2 << bitShift2);
+				break;
+			case 2: // val 1 is not reverse, val 2 is
+				dataToWrite = (val1 << bitShift1) + ((subValue2 - val2) << bitShift2);
+				break;
+			case 3: // both vals reversed
+				dataToWrite = ((subValue1 - val1) << bitShift1) + ((subValue2 - val2) << bitShift2);
+				break;
+			case 4: // not shared, not reverse (SSGEG if 0, frequency A0)
+				dataToWrite = val1;
+				break;
+			case 5: // for detune & oct, which have a a min value of -3 (val1)
+				dataToWrite = ((val1 + 3) << bitShift1) + (val2 << bitShift2);
+				break;
+			case 6: // for detune & oct, which have a a min value of -3 (val2)
+				dataToWrite = (val1 << bitShift1) + ((val2 + 3) << bitShift2);
+				break;
+			case 7: // only sustain rate, which is both not shared AND reversed
+				dataToWrite = subValue1 - val1;
+				break;
+			case 8: // only for reg B4+ which has pan (always both L and R true)
+				dataToWrite = 0xC0 + (val1 << bitShift1) + (val2 << bitShift2);
+				break;
+			case 9: // not shared, but reverse (total lvl)
+				dataToWrite = subValue1 - val1;
+				break;
+			default:
+				dataToWrite = val1;
+				break;
+		}
+		
+		// add to the preset's burst if one is being built, otherwise send on its own
+		if(glb.burstOpen){
+			chanAdd(regToWrite, dataToWrite);
+		} else {
+			partBurst(ym.part);
+			chanAdd(regToWrite, dataToWrite);
+			burstEnd();
 		}
 		
 	} else { // only LFO register 0x22 is global (among the registers being written to in this function anyway)
@@ -496,53 +1277,98 @@ void printToLCD(int options){
 	int val = *ym.value;
 	
 	uint8_t op = ym.op;
-	const char* param = params[ym.group][ym.current];
+	PGM_P param = params[ym.group][ym.current];
 	
-	home(); // line 1, spot 1
-	printf("                \n                "); // clear screen
-	home();
+	lcd_fb_clear(); // only the characters that end up different get sent
 
 	switch(options){
 		case 0: // not operator, no strings
-			printf("%s:\n%d",param,val);
+			printf_P(PSTR("%S:\n%d"),param,val);
 			break;
 		case 1: // regular operator params
-			printf("op %d %s:\n%d",op+1,param,val);
+			printf_P(PSTR("op %d %S:\n%d"),op+1,param,val);
 			break;
 		case 2:  // just mult (0 = 0.5, everything else is normal)
 			if(val == 0){
-				printf("op %d %s:\n0.5",op+1,param);
+				printf_P(PSTR("op %d %S:\n0.5"),op+1,param);
 			} else {
-				printf("op %d %s:\n%d",op+1,param,val);
+				printf_P(PSTR("op %d %S:\n%d"),op+1,param,val);
 			}
 			break;
 		case 3: // algorithm
-			printf("%s %d:\n%s",param,val+1,algorithms[val]);
+			printf_P(PSTR("%S %d:\n%S"),param,val+1,algorithms[val]);
 			break;
 		case 4: // on or off params (AM and... i think thats it for now)
-			printf("op %d %s:\n%s",op+1,param,onOff[val]);
+			printf_P(PSTR("op %d %S:\n%S"),op+1,param,onOff[val]);
 			break;
 		case 5: // LFO
-			printf("%s:\n%s",param,lfoFreqs[val]);
+			printf_P(PSTR("%S:\n%S"),param,lfoFreqs[val]);
 			break;
 		case 6: // SSGEG
-			printf("op %d %s:\n%s",op+1,param,egTypes[val]);
+			printf_P(PSTR("op %d %S:\n%S"),op+1,param,egTypes[val]);
 			break;
 		case 7: // preset patch
-			printf("%s:\n%s",param,patchNames[val]);
+			printf_P(PSTR("%S:\n%S"),param,patchNames[val]);
 			break;
 		case 8: // polyphony
-			printf("%s:\n%s",param,playModes[val]);
+			printf_P(PSTR("%S:\n%S"),param,playModes[val]);
 			break;
 		case 9: // anything just on/off (non-operator)
-			printf("%s:\n%s",param,onOff[val]);
+			printf_P(PSTR("%S:\n%S"),param,onOff[val]);
+			break;
+		case 10: // user patch slots
+			printf_P(PSTR("%S:\n%d%s"),param,val+1,userEmpty(val) ? " (empty)" : "");
+			break;
+		case 11: // user slot just saved to
+			printf_P(PSTR("%S:\n%d saved"),param,val+1);
+			break;
+		case 12: // MIDI channel, 0 is all
+			if(val == 0){
+				printf_P(PSTR("%S:\nall"),param);
+			} else {
+				printf_P(PSTR("%S:\n%d"),param,val);
+			}
+			break;
+		case 13: // counting from 1 (part)
+			printf_P(PSTR("%S:\n%d"),param,val+1);
+			break;
+		case 14: // modulation destination
+			printf_P(PSTR("%S:\n%S"),param,modDests[val]);
+			break;
+		case 15: // soft LFO destination
+			printf_P(PSTR("%S:\n%S"),param,softDests[val]);
+			break;
+		case 16: // diagnostics, val is the page
+			if(val == 0){
+				printf_P(PSTR("latency us:\n%lu %lu %lu"),glb.latencyMin*32UL,(glb.latencyAvg>>3)*32,glb.latencyMax*32UL);
+			} else if(val == 1){
+				printf_P(PSTR("SPI per second:\n%u fr %u B"),glb.spiFrameRate,glb.spiByteRate);
+			} else if(val == 2){
+				printf_P(PSTR("queue high:\nSPI %u MIDI %u"),glb.spiHigh,glb.midiHigh);
+			} else if(val == 3){
+				printf_P(PSTR("MIDI full/DOR/FE\n%u %u %u"),glb.midiDropped,glb.midiOverrun,glb.midiFrameErr);
+			} else if(val == 4){
+				printf_P(PSTR("slave lost:\n%u frames"),glb.slaveLost);
+			} else {
+				printf_P(PSTR("ISR cycles max:\n%S %u"),isrNames[val-5],glb.isrMax[val-5]);
+			}
+			break;
+		case 17: // random patch
+			printf_P(PSTR("%S:\n#%d"),param,val+1);
+			break;
+		case 18: // MIDI channel, 0 is none (drum channel)
+			if(val == 0){
+				printf_P(PSTR("%S:\nOFF"),param);
+			} else {
+				printf_P(PSTR("%S:\n%d"),param,val);
+			}
 			break;
 	}
 }
 
 // restrict passed value within min/max values
-void minMaxValue(int* var, int min, int max){
-	int varVal = *var;
+void minMaxValue(int8_t* var, int8_t min, int8_t max){
+	int8_t varVal = *var;
 	
 	if(varVal < min){
 		*var = max;
@@ -551,164 +1377,352 @@ void minMaxValue(int* var, int min, int max){
 	}
 }
 
-// change all parameters at once (for preset()) within program as well as writing to YM2612
-// TODO: include polyphony in params
-void changeAllParams(int alg, int fb, int lfo, int vib, int trem,
-int mult0, int  mult1, int mult2, int mult3, int det0, int det1, int det2, int det3,
-int tl0, int tl1, int tl2, int tl3, int atk0, int atk1, int atk2, int atk3,
-int dcy0, int dcy1, int dcy2, int dcy3, int sl0, int sl1, int sl2, int sl3,
-int sr0, int sr1, int sr2, int sr3, int rel0, int rel1, int rel2, int rel3,
-int rs0, int rs1, int rs2, int rs3, int eg0, int eg1, int eg2, int eg3,
-int am0, int am1, int am2, int am3){
-	
-	// change param values inside program:
+// add step to passed value - a single step past min or max wraps around to the other end, same as minMaxValue(),
+// but a bigger step (several detents added up) stops at the end, so a fast spin doesn't land somewhere random
+// the sum is done in 16 bits so 127 + 1 wraps to min instead of overflowing the int8_t
+void stepValue(int8_t* var, int8_t step, int8_t min, int8_t max){
+	int16_t varVal = *var + step;
 	
+	if(varVal < min){
+		*var = (step == -1) ? max : min;
+	} else if(varVal > max){
+		*var = (step == 1) ? min : max;
+	} else {
+		*var = varVal;
+	}
+}
+
+// set all parameter values inside the program from a register-ready patch
+// undoes the same encoding writeToYM() does (reversed rates/levels, detune offset, etc)
+void patchDecode(const struct Patch* patch){
 	// non-operator params:
-	ym.algorithm = alg;
-	ym.feedback = fb;
-	ym.lfoFreq = lfo;
-	ym.vibrato = vib;
-	ym.tremolo = trem;
-	
-	// reconstruct operator arrays:
-	
-	// group 1
-	int mult[] = {mult0, mult1, mult2, mult3};
-	int det[] = {det0, det1, det2, det3};
-	int tl[] = {tl0, tl1, tl2, tl3};
+	ym.algorithm = patch->algFb & 0x07;
+	ym.carriers = pgm_read_byte(&carrierMask[ym.algorithm]); // patchLoad() sends every level anyway
+	ym.feedback = (patch->algFb >> 3) & 0x07;
+	ym.lfoFreq = (patch->lfo & 0x08) ? (patch->lfo & 0x07) + 1 : 0; // 0 is LFO off
+	ym.vibrato = patch->lfoSens & 0x07;
+	ym.tremolo = (patch->lfoSens >> 4) & 0x03;
 	
-	// group 2
-	int atk[] = {atk0, atk1, atk2, atk3};
-	int dcy[] = {dcy0, dcy1, dcy2, dcy3};
-	int sl[] = {sl0, sl1, sl2, sl3};
-	int sr[] = {sr0, sr1, sr2, sr3};
-	int rel[] = {rel0, rel1, rel2, rel3};
-	int rs[] = {rs0, rs1, rs2, rs3};
-	int eg[] = {eg0, eg1, eg2, eg3};
+	// operator params:
+	for(int i = 0; i < 4; i++){
+		// group 1
+		ym.multiple[i] = patch->dtMul[i] & 0x0F;
+		ym.detune[i] = (patch->dtMul[i] >> 4) - 3;
+		ym.totalLvl[i] = 127 - patch->tl[i];
+		
+		// group 2
+		ym.attack[i] = 31 - (patch->rsAr[i] & 0x1F);
+		ym.rateScl[i] = patch->rsAr[i] >> 6;
+		ym.decay[i] = 31 - (patch->amD1r[i] & 0x1F);
+		ym.susRate[i] = 31 - patch->d2r[i];
+		ym.susLvl[i] = 15 - (patch->slRr[i] >> 4);
+		ym.release[i] = 15 - (patch->slRr[i] & 0x0F);
+		ym.ssgeg[i] = (patch->ssgEg[i] & 0x08) ? (patch->ssgEg[i] & 0x07) + 1 : 0; // 0 is SSG-EG off
+		
+		// group 3
+		ym.amOn[i] = patch->amD1r[i] >> 7;
+	}
+}
+
+// change all parameters of a part at once within program as well as writing to YM2612
+// the patch is already register-ready, so everything but the global LFO register is streamed
+// straight into a single broadcast burst (the shadow drops whatever is already set)
+// with split on it's a burst for the part's port instead, 3 writes per register, which takes a few bursts
+// the ym values only change if it's the part being edited
+void patchLoad(const struct Patch* patch, uint8_t part){
+	glb.parts[part] = *patch;
+	if(part == ym.part) patchDecode(patch);
 	
-	// group 3
-	int am[] = {am0, am1, am2, am3};
+	sendreg(0, 0x22, patch->lfo); // LFO is global, so it goes out on its own
 	
-	// write non-operator parameters to YM:
-	writeToYM(0,alg,fb,0xB0,0,3,0,1,0,0,0); // algorithm & feedback share one register (group 1)
+	partBurst(part);
 	
-	if(lfo == 0){ // special case for LFO (group 3)
-		writeToYM(0,0,0,0x22,0,3,0,0,0,0,0);
-	} else {
-		writeToYM(0,lfo-1,1,0x22,0,3,0,0,0,0,0);
+	chanAdd(0xB0, patch->algFb);
+	chanAdd(0xB4, patch->lfoSens);
+	
+	for(int i = 0; i < 4; i++){
+		chanAdd(0x30 + opOffset[i], patch->dtMul[i]);
+		chanAdd(0x40 + opOffset[i], patch->tl[i]);
+		chanAdd(0x50 + opOffset[i], patch->rsAr[i]);
+		chanAdd(0x60 + opOffset[i], patch->amD1r[i]);
+		chanAdd(0x70 + opOffset[i], patch->d2r[i]);
+		chanAdd(0x80 + opOffset[i], patch->slRr[i]);
+		chanAdd(0x90 + opOffset[i], patch->ssgEg[i]);
 	}
 	
-	writeToYM(0,vib,trem,0xB4,0,4,0,1,8,0,0); // vib & trem share one register (group 3)
+	burstEnd();
+	
+	modMarkAll(); // modulation goes back on top of the new patch's values
+}
+
+// the other way around from patchDecode(): put the current parameter values back into register-ready form
+void patchEncode(struct Patch* patch){
+	patch->lfo = ym.lfoFreq ? 0x08 | (ym.lfoFreq - 1) : 0;
+	patch->algFb = (ym.feedback << 3) | ym.algorithm;
+	patch->lfoSens = 0xC0 | (ym.tremolo << 4) | ym.vibrato;
+	
+	for(int i = 0; i < 4; i++){
+		patch->dtMul[i] = ((ym.detune[i] + 3) << 4) | ym.multiple[i];
+		patch->tl[i] = 127 - ym.totalLvl[i];
+		patch->rsAr[i] = (ym.rateScl[i] << 6) | (31 - ym.attack[i]);
+		patch->amD1r[i] = (ym.amOn[i] << 7) | (31 - ym.decay[i]);
+		patch->d2r[i] = 31 - ym.susRate[i];
+		patch->slRr[i] = ((15 - ym.susLvl[i]) << 4) | (15 - ym.release[i]);
+		patch->ssgEg[i] = ym.ssgeg[i] ? 0x08 | (ym.ssgeg[i] - 1) : 0;
+	}
+}
+
+// copy the selected preset patch out of flash and load it, both within program and within YM2612
+void preset(){
+	struct Patch patch;
+	
+	memcpy_P(&patch, &presets[ym.patchNum], sizeof(struct Patch));
+	patchLoad(&patch, ym.part);
+}
+
+// 16 bit xorshift (7, 9, 8), scaled to min-max without dividing
+uint8_t randNext(uint8_t min, uint8_t max){
+	uint16_t x = glb.randState;
+	
+	x ^= x << 7;
+	x ^= x >> 9;
+	x ^= x << 8;
+	glb.randState = x;
+	
+	return min + (((x >> 8) * (uint16_t)(max - min + 1)) >> 8);
+}
+
+// a new patch for the part being edited, sent in one burst by patchLoad() like a preset
+// everything is kept to ranges that make a playable sound: carriers stay loud and modulators don't go past
+// the point of noise, attack and release rates are never 0 (silent or never ending), the multiples of the
+// carriers stay low so the pitch sounds like the note played, and LFO/SSG-EG are only on some of the time
+void randomPatch(){
+	struct Patch patch;
+	uint8_t carriers;
+	
+	glb.randState ^= TCNT1; // when the button was pressed is as random as it gets
+	if(glb.randState == 0) glb.randState = 1;
+	
+	uint8_t algorithm = randNext(0, 7);
+	carriers = pgm_read_byte(&carrierMask[algorithm]);
+	
+	patch.algFb = (randNext(0, 6) << 3) | algorithm;
+	patch.lfo = randNext(0, 3) ? 0 : 0x08 | randNext(0, 7);
+	patch.lfoSens = 0xC0 | (patch.lfo ? (randNext(0, 1) << 4) | randNext(0, 3) : 0);
 	
-	// operator params:
 	for(int i = 0; i < 4; i++){
-		// change all operator params in program for each operator
-		ym.multiple[i] = mult[i];
-		ym.detune[i] = det[i];
-		ym.totalLvl[i] = tl[i];
-		ym.attack[i] = atk[i];
-		ym.decay[i] = dcy[i];
-		ym.susLvl[i] = sl[i];
-		ym.susRate[i] = sr[i];
-		ym.rateScl[i] = rs[i];
-		ym.ssgeg[i] = eg[i];
-		ym.amOn[i] = am[i];
+		bool carrier = carriers & (1 << i);
+		uint8_t ssg = randNext(0, 15) ? 0 : 0x08 | randNext(0, 7);
 		
-		// group 1
-		writeToYM(i,mult[i],det[i],0x30,0,4,1,1,6,0,0);
-		writeToYM(i,tl[i],0,0x40,0,0,1,1,9,127,0); // total level has its own reg
+		patch.dtMul[i] = (randNext(0, 6) << 4) | (carrier ? randNext(1, 4) : randNext(0, 12));
+		patch.tl[i] = carrier ? randNext(0, 12) : randNext(8, 60);
+		patch.rsAr[i] = (randNext(0, 3) << 6) | (carrier ? randNext(14, 31) : randNext(8, 31));
+		patch.amD1r[i] = (patch.lfo && !randNext(0, 3) ? 0x80 : 0) | randNext(0, 24);
+		patch.d2r[i] = randNext(0, 15);
+		patch.slRr[i] = (randNext(0, 15) << 4) | randNext(carrier ? 3 : 2, 15);
+		patch.ssgEg[i] = ssg;
+	}
+	
+	patchLoad(&patch, ym.part);
+	
+	stepValue(&ym.randNum, 1, 0, 99);
+}
+
+// a slot that's being saved counts as saved already
+bool userEmpty(uint8_t slot){
+	if(glb.saveNext < sizeof(struct UserSlot) && slot == glb.saveSlot) return false;
+	
+	return eeprom_read_byte(&userSlots[slot].used) != USER_MAGIC;
+}
+
+// read the selected user patch out of EEPROM and load it just like a preset - empty slots do nothing
+void userRecall(){
+	struct UserSlot slot;
+	
+	if(userEmpty(ym.userSlot)) return;
+	
+	if(glb.saveNext < sizeof(struct UserSlot) && ym.userSlot == glb.saveSlot){ // not all in EEPROM yet
+		patchLoad(&glb.saveBuf.patch, ym.part);
+	} else {
+		eeprom_read_block(&slot, &userSlots[ym.userSlot], sizeof(struct UserSlot));
+		patchLoad(&slot.patch, ym.part);
+	}
+}
+
+// save the current sound to the selected slot: it's copied now, eepromTask() does the actual writing
+// a save started while another is still going replaces it (the earlier slot may end up half written)
+void userSave(){
+	patchEncode(&glb.saveBuf.patch);
+	glb.saveBuf.used = USER_MAGIC;
+	glb.saveSlot = ym.saveSlot;
+	glb.saveNext = 0;
+}
+
+// program change: bank 0 is the presets, bank 1 the user patches - either bank select byte can say 1, since
+// some gear only sends CC0 and some only CC32.  programs past the end of the bank and empty user slots are ignored
+// the patch is read out now, so it's ready to go in one burst when pendingLoad() gets to it
+// the screen's patch/slot number only follows program changes for the part being edited
+void programChange(uint8_t program, uint8_t part){
+	struct UserSlot slot;
+	uint8_t bank = glb.bankMsb | glb.bankLsb;
+	
+	if(bank == 0 && program <= MAX_PRESET){
+		memcpy_P(&glb.pending[part], &presets[program], sizeof(struct Patch));
+		if(part == ym.part) ym.patchNum = program;
 		
-		// group 2
-		writeToYM(i,atk[i],rs[i],0x50,0,6,1,1,1,31,0);
-		writeToYM(i,dcy[i],am[i],0x60,0,7,1,1,1,31,0); // AM is in group 4
-		writeToYM(i,sl[i],rel[i],0x80,4,0,1,1,3,15,15);
-		writeToYM(i,sr[i],0,0x70,0,0,1,1,7,31,0); // sustain rate has its own reg
-		// finally, SSGEG
-		if(eg[i] == 0){
-			writeToYM(i,0,0,0x90,0,3,1,1,4,0,0);
+	} else if(bank == 1 && program < USER_SLOTS && !userEmpty(program)){
+		if(glb.saveNext < sizeof(struct UserSlot) && program == glb.saveSlot){ // not all in EEPROM yet
+			glb.pending[part] = glb.saveBuf.patch;
 		} else {
-			writeToYM(i,eg[i]-1,1,0x90,0,3,1,1,0,0,0);
+			eeprom_read_block(&slot, &userSlots[program], sizeof(struct UserSlot));
+			glb.pending[part] = slot.patch;
 		}
+		if(part == ym.part) ym.userSlot = program;
+		
+	} else {
+		return;
 	}
+	
+	glb.pendingValid |= 1<<part;
 }
 
-// for each preset patch, format name to be printed and change values of params, both within program and within YM2612
-void preset(){		
-	switch(ym.patchNum){
-		case 0: // ding dong piano
-			// params are grouped according to whether they're global, or groups of 4 for operator
-			// i.e. alg,fb,lfo,vib,trem, mult[0-3], det[0-3], tl[0-3], atk[0-3], dec[0-3], sl[0-3], sr[0-3], rel[0-3], rs[0-3], eg[0-3], am[0-3]
-			changeAllParams(7,0,0,0,0, 10,8,4,2, -3,1,3,0, 63,117,117,127, 0,0,0,0, 23,23,23,23, 0,0,0,0, 29,29,29,29, 1,1,1,1, 1,2,1,2, 0,0,0,0, 0,0,0,0);
-			break;
-		case 1: // toxic sludge
-			changeAllParams(3,4,2,4,0, 1,10,2,6, 0,0,0,0, 127,127,127,127, 0,2,12,7, 4,0,23,31, 14,5,0,13, 29,16,0,29, 7,5,8,7, 1,1,1,1, 0,0,0,0, 0,0,0,0);
-			break;
-		case 2: // wooden steel
-			changeAllParams(4,0,0,0,0, 10,8,4,2, -3,1,3,0, 27,112,112,127, 0,0,9,0, 16,16,16,21, 0,0,0,0, 29,29,29,29, 7,7,7,10, 1,2,1,2, 0,0,0,0, 0,0,0,0);
-			break;
-		case 3: // steel drum pad
-			changeAllParams(5,3,3,0,3, 10,8,6,2, -3,1,3,0, 100,117,117,127, 10,26,25,0, 15,23,16,21, 13,7,12,0, 29,29,29,29, 9,1,19,11, 1,2,1,2, 0,0,0,0, 0,0,1,0);
-			break;
-		case 4: // (un)naturhythm
-			changeAllParams(0,6,1,6,2, 10,8,1,2, -3,1,3,0, 88,112,112,127, 14,17,14,8, 18,19,19,22, 0,0,0,15, 29,29,29,29, 6,6,6,8, 2,1,2,1, 3,1,3,0, 1,1,1,0);
-			break;
-		case 5: // reedy ripper
-			changeAllParams(2,5,0,0,0, 1,2,7,2, 3,-3,3,0, 126,97,106,127, 16,19,27,10, 27,22,26,21, 13,10,12,12, 31,31,31,27, 8,8,8,8, 1,1,1,1, 0,0,0,0, 0,0,0,0);
-			break;
-		case 6: // lately who?
-			changeAllParams(7,4,0,0,0, 4,2,1,2, -2,2,1,-1, 124,117,120,127, 0,0,0,0, 16,23,31,12, 0,0,0,0, 29,29,0,18, 1,1,1,1, 1,1,1,1, 0,0,0,0, 0,0,0,0);
-			break;
-		case 7: // tuned bounce
-			changeAllParams(3,0,0,0,0, 4,6,3,4, -3,2,3,-1, 111,79,118,127, 11,14,2,1, 15,20,10,17, 0,0,0,0, 29,29,29,29, 9,1,10,9, 2,2,1,2, 0,0,0,0, 0,0,0,0);
-			break;
-		case 8: // morph metal
-			changeAllParams(3,4,0,0,0, 4,6,7,4, -1,2,3,-1, 111,117,118,127, 10,22,27,1, 15,20,17,21, 0,0,0,0, 29,29,31,29, 9,1,10,9, 2,2,1,2, 0,0,0,0, 0,0,0,0);
-			break;
-		case 9: // get(s) nasty
-			changeAllParams(3,5,0,0,0, 2,3,2,1, -2,-2,1,0, 116,118,119,127, 25,23,0,0, 25,27,19,24, 9,10,11,13, 31,31,31,31, 4,4,4,4, 1,1,1,1, 0,0,0,0, 0,0,0,0);
-			break;
-		case 10: // flarp wobble
-			changeAllParams(5,5,2,5,2, 2,2,2,2, -1,1,3,0, 108,117,124,127, 8,6,12,7, 25,16,27,26, 4,0,0,0, 29,29,29,29, 4,1,3,2, 1,2,1,2, 0,0,0,0, 0,0,1,0);
-			break;
-		case 11: // pan flute
-			changeAllParams(4,6,3,2,3, 4,5,4,4, -3,3,-2,0, 117,114,117,127, 3,22,29,18, 16,28,23,20, 0,0,0,0, 29,29,29,29, 7,7,8,7, 1,1,1,1, 0,0,0,0, 0,1,0,0);
-			break;
-		case 12: // deceptive bass
-			changeAllParams(5,2,5,0,1, 2,2,10,6, 0,0,0,0, 127,104,118,127, 27,16,0,0, 25,19,19,21, 5,0,12,0, 31,31,31,31, 9,8,8,8, 2,2,1,1, 0,1,0,0, 0,0,1,0);
-			break;
-		case 13: // jagged EP
-			changeAllParams(6,5,2,0,2, 7,3,14,3, -3,-1,3,1, 113,120,125,118, 0,0,25,0, 22,23,22,23, 11,11,11,11, 31,31,31,31, 10,8,8,8, 1,1,1,1, 0,0,0,0, 0,0,1,0);
-			break;
-		case 14: // all consuming
-			changeAllParams(5,5,3,0,2, 1,1,4,2, 0,0,0,0, 120,120,120,127, 27,28,20,24, 30,26,8,28, 0,3,0,10, 7,31,31,31, 9,7,7,7, 1,1,1,1, 0,0,1,0, 0,1,0,0);
-			break;
-		case 15: // one operator
-			changeAllParams(7,0,0,0,0, 2,2,2,2, 0,0,0,0, 0,0,0,127, 0,0,0,0, 31,31,31,31, 15,15,15,15, 31,31,31,31, 0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0);
-			break;
-		case 16: // squelchy
-			changeAllParams(1,0,0,0,0, 10,8,4,2, -3,1,3,0, 27,112,112,127, 18,10,20,0, 16,0,29,25, 0,0,0,0, 29,29,29,29, 7,7,7,10, 1,2,1,2, 0,0,0,0, 0,0,0,0);
-			break;
-		case 17: // ugly bell
-			changeAllParams(6,4,0,0,0, 10,1,1,1, 0,0,0,0, 120,120,120,127, 0,0,0,0, 24,19,25,13, 0,0,0,0, 31,31,31,31, 8,8,6,9, 1,1,1,1, 0,0,0,0, 0,0,0,0);
-			break;
-		case 18: // moving electric
-			changeAllParams(2,4,1,0,1, 2,6,8,4, -3,0,3,0, 120,111,105,125, 14,23,0,14, 24,23,22,31, 0,0,8,12, 24,23,27,31, 9,8,8,9, 1,2,2,0, 0,0,7,0, 0,1,1,0);
-			break;
-		case 19: // wurly slow dance
-			changeAllParams(5,5,1,0,2, 4,2,10,2, 2,-1,1,0, 113,114,109,127, 0,23,21,0, 23,24,26,27, 0,0,0,0, 31,31,31,31, 7,7,9,9, 0,2,1,0, 0,0,3,0, 0,1,0,0);
-			break;
-		case 20: // ambient banjo
-			changeAllParams(4,4,0,0,0, 4,3,7,2, 0,-1,1,0, 105,116,102,127, 18,0,14,0, 20,21,17,19, 7,0,0,0, 24,23,23,21, 9,9,9,9, 0,0,0,0, 8,0,0,0, 0,0,0,0);
-			break;
+// load the patch from a part's last program change, and show it if the screen is on that part's patch
+// only called once none of the part's keys are held, or right before its next note on, so the sound never
+// changes under a note that's being played
+void pendingLoad(uint8_t part){
+	glb.pendingValid &= ~(1<<part);
+	
+	patchLoad(&glb.pending[part], part);
+	
+	if(part != ym.part){
+		return;
+	} else if(ym.value == &ym.patchNum){
+		printToLCD(7);
+	} else if(ym.value == &ym.userSlot){
+		printToLCD(10);
+	}
+}
+
+// true if any of a part's channels has its key still down (released channels that are only ringing out don't count)
+bool notesHeld(uint8_t part){
+	uint8_t mask = partMask(part);
+	
+	for(uint8_t i = 0; i < 6; i++){
+		if((mask & (1<<i)) && ym.notesOn[i][1]) return true;
+	}
+	
+	return false;
+}
+
+// sendreg() flag for writing to a part's channels: the part's port, or 2 (both) if split is off
+uint8_t partPort(uint8_t part){
+	return ym.split ? part : 2;
+}
+
+// channels in a part, bit i for channel i - not channel 6 while it's the drums' DAC
+uint8_t partMask(uint8_t part){
+	uint8_t dac = ym.drumChan ? 0x20 : 0;
+	
+	if(!ym.split) return 0x3F & ~dac;
+	
+	return (part ? 0x38 : 0x07) & ~dac;
+}
+
+// part a channel plays for
+uint8_t voicePart(uint8_t voice){
+	return ym.split && voice > 2;
+}
+
+// start a burst for writing to every channel of a part - a broadcast, or a burst for one port
+void partBurst(uint8_t part){
+	uint8_t port = partPort(part);
+	
+	burstBegin(port == 2 ? FRAME_BCAST : FRAME_BURST | port);
+}
+
+// add a per channel register write (the channel 1/4 register, reg) to the open burst for all of its part's channels:
+// a broadcast burst writes all 6 from the one pair, a one port burst needs a pair for each of the 3 channels
+void chanAdd(uint8_t reg, uint8_t data){
+	burstAdd(reg, data);
+	
+	if(glb.burst[0] != FRAME_BCAST){
+		burstAdd(reg + 1, data);
+		burstAdd(reg + 2, data);
+	}
+}
+
+// switch the interface to the other part: the part being left keeps its values in glb.parts[],
+// the one coming up gets its values out of there (nothing needs writing, the YM2612 already has them)
+void partSelect(uint8_t part){
+	patchEncode(&glb.parts[ym.part]);
+	ym.part = part;
+	patchDecode(&glb.parts[part]);
+}
+
+// split turned on: part 2 starts out as a copy of part 1, which is what its channels are playing already
+// split turned off: part 1's patch goes back to all 6 channels
+void splitChange(){
+	notesReset(); // channels are allocated differently now
+	
+	if(ym.split){
+		patchEncode(&glb.parts[0]);
+		glb.parts[1] = glb.parts[0];
+	} else {
+		if(ym.part) partSelect(0);
+		patchEncode(&glb.parts[0]);
+		glb.pendingValid &= ~(1<<1); // there's no part 2 to load it into any more
+		
+		patchLoad(&glb.parts[0], 0);
 	}
+}
+
+// the DAC takes over channel 6 when a drum channel is set, and gives it back when it's turned off
+void drumChange(){
+	notesReset(); // channel 6 might be playing, and the allocator has one channel more or less
+	
+	sendreg(0, 0x2B, ym.drumChan ? 0x80 : 0x00); // DAC on/off
+}
+
+// the sample goes to the slave in one short frame, the slave plays it from its own flash
+// notes without a sample do nothing, and note offs don't matter (samples always play to the end)
+void drumNote(uint8_t noteIn, uint8_t velocity){
+	uint8_t frame[3];
+	
+	if(noteIn < DRUM_FIRST || noteIn > DRUM_LAST) return;
+	
+	frame[0] = FRAME_DAC;
+	frame[1] = pgm_read_byte(&drumMap[noteIn - DRUM_FIRST]);
+	frame[2] = velocity;
+	
+	if(frame[1] != NO_SAMPLE) spiQueue(frame, 3);
+}
+
+// part a message on a MIDI channel (0-15) is for:
+// part 2 if split is on and it's part 2's channel, part 1 if it's the receive channel (or that's set to all)
+uint8_t midiPart(uint8_t channel){
+	++channel; // 1-16 like on the screen
 	
+	if(ym.split && channel == ym.midiChan2) return 1;
+	if(ym.midiChan == 0 || channel == ym.midiChan) return 0;
+	
+	return NO_PART;
+}
+
+// write the next byte of the user patch being saved, if the EEPROM is done with the last one
+// (each byte takes 3.4 ms, waiting for all 32 would hold up MIDI for over 100 ms)
+// bytes that are already the same aren't written again
+void eepromTask(){
+	if(glb.saveNext >= sizeof(struct UserSlot) || !eeprom_is_ready()) return;
+	
+	eeprom_update_byte((uint8_t*)&userSlots[glb.saveSlot] + glb.saveNext, ((uint8_t*)&glb.saveBuf)[glb.saveNext]);
+	++glb.saveNext;
 }
 
 // this and changeCurrent() are responsible for the structure of the interface
-// if group is changed: restrict group number within 0-3, change currently selected param, print
+// if group is changed: restrict group number within 0-4, change currently selected param, print
 // only needed for first element of each group
 void changeGroup(){
-	minMaxValue(&ym.group,0,3);
+	minMaxValue(&ym.group,0,4);
 	
 	ym.current = 0; // display is at FIRST element of group when group is changed (possible TODO: have it go back to previously selected value)
 	
@@ -729,6 +1743,10 @@ void changeGroup(){
 			ym.value = &ym.lfoFreq;
 			printToLCD(5);
 			break;
+		case 4:
+			ym.value = &ym.modDest[MOD_WHEEL];
+			printToLCD(14);
+			break;
 	}
 }
 
@@ -741,7 +1759,7 @@ void changeCurrent(){
 	uint8_t op = ym.op;
 	
 	if(ym.group == 0){ // more will be added here eventually
-		minMaxValue(&ym.current,0,3);
+		minMaxValue(&ym.current,0,12);
 		
 		switch(ym.current){
 			case 0:
@@ -760,6 +1778,42 @@ void changeCurrent(){
 				ym.value = &ym.polyphony;
 				printToLCD(8);
 				break;
+			case 4:
+				ym.value = &ym.bendRange;
+				printToLCD(0);
+				break;
+			case 5:
+				ym.value = &ym.userSlot;
+				printToLCD(10);
+				break;
+			case 6:
+				ym.value = &ym.saveSlot;
+				printToLCD(10);
+				break;
+			case 7:
+				ym.value = &ym.midiChan;
+				printToLCD(12);
+				break;
+			case 8:
+				ym.value = &ym.split;
+				printToLCD(9);
+				break;
+			case 9:
+				ym.value = &ym.midiChan2;
+				printToLCD(0);
+				break;
+			case 10:
+				ym.value = &ym.part;
+				printToLCD(13);
+				break;
+			case 11:
+				ym.value = &ym.randNum;
+				printToLCD(17);
+				break;
+			case 12:
+				ym.value = &ym.drumChan;
+				printToLCD(18);
+				break;
 		}
 		
 	} else if(ym.group == 1){
@@ -819,7 +1873,7 @@ void changeCurrent(){
 				break;
 		}
 	} else if(ym.group == 3){
-		minMaxValue(&ym.current,0,3);
+		minMaxValue(&ym.current,0,7);
 		switch(ym.current){
 			case 0: // lfoFreq
 				ym.value = &ym.lfoFreq;
@@ -837,92 +1891,260 @@ void changeCurrent(){
 				ym.value = &ym.amOn[op];
 				printToLCD(4);
 				break;
+			case 4:
+				ym.value = &ym.softDest;
+				printToLCD(15);
+				break;
+			case 5:
+				ym.value = &ym.softRate;
+				printToLCD(0);
+				break;
+			case 6:
+				ym.value = &ym.softDepth;
+				printToLCD(0);
+				break;
+			case 7:
+				ym.value = &ym.softFade;
+				printToLCD(0);
+				break;
+		}
+	} else if(ym.group == 4){ // a destination and a depth for each source
+		minMaxValue(&ym.current,0,2*MOD_SOURCES-1);
+		if(ym.current & 1){
+			ym.value = &ym.modDepth[ym.current >> 1];
+			printToLCD(0);
+		} else {
+			ym.value = &ym.modDest[ym.current >> 1];
+			printToLCD(14);
+		}
+	}
+}
+
+// take the interface events recorded by the PCINT2 ISR since last time and act on them
+// all the detents since the last time around are added up, so a fast spin is one register write and one
+// screen update instead of one per detent
+// selection changes go first, one step at a time so changeGroup()/changeCurrent() wrap the same way they always have
+// (they only change which parameter is shown), then all the value detents are applied as one step
+void uiUpdate(){
+	int8_t group, op, current, value, accel;
+	bool save;
+	
+	cli(); // take them all at once so none get lost in between
+	group = glb.uiGroup;
+	op = glb.uiOp;
+	current = glb.uiCurrent;
+	value = glb.uiValue;
+	accel = glb.uiAccel;
+	save = glb.uiSave;
+	glb.uiGroup = 0;
+	glb.uiOp = 0;
+	glb.uiCurrent = 0;
+	glb.uiValue = 0;
+	glb.uiAccel = 0;
+	glb.uiSave = false;
+	sei();
+	
+	for(; group < 0; group++){ --ym.group; changeGroup(); }
+	for(; group > 0; group--){ ++ym.group; changeGroup(); }
+	
+	for(; op < 0; op++){ --ym.op; changeCurrent(); }
+	for(; op > 0; op--){ ++ym.op; changeCurrent(); }
+	
+	for(; current < 0; current++){ --ym.current; changeCurrent(); }
+	for(; current > 0; current--){ ++ym.current; changeCurrent(); }
+	
+	if(value){ // one register write and one screen update however far it moved
+		changeValue(accelerated() ? accel : value);
+		patchEncode(&glb.parts[ym.part]); // voiceOn() and a part change read the patch from there
+		modMarkAll(); // the change went out at the patch value, modulation goes back on top on the next tick
+	}
+	
+	if(save && ym.value == &ym.saveSlot){
+		userSave();
+		printToLCD(11);
+	} else if(save && ym.value == &ym.randNum){ // the chord is one more way to roll a new one
+		randomPatch();
+		printToLCD(17);
+	} else if(save && ym.value == &ym.diag){ // already showing: clear them
+		diagClear();
+		printToLCD(16);
+	} else if(save && ym.group == 0){ // anywhere else in group 0 it's the hidden diagnostics page
+		ym.diag = 0;
+		ym.value = &ym.diag;
+		printToLCD(16);
+	}
+}
+
+// parameters with enough values that one step per detent is too slow: levels (0-127), min velocity (0-127),
+// the attack/decay/sustain rates (0-31) and the soft LFO's rate, depth and fade (0-127)
+// everything else is small enough that every value should be easy to land on
+bool accelerated(){
+	int8_t* val = ym.value;
+	int8_t op = ym.op;
+	
+	return val == &ym.totalLvl[op] || val == &ym.minVel || val == &ym.attack[op] || val == &ym.decay[op]
+		|| val == &ym.susRate[op] || val == &ym.softRate || val == &ym.softDepth || val == &ym.softFade;
+}
+
+// steps for one value detent turning in direction dir (1 or -1), 1 to 8 depending on how soon it came after the last one
+// changing direction always starts back at 1, so backing up to the value you wanted is easy
+// called from the PCINT2 ISR
+int8_t accelStep(int8_t dir, uint8_t now){
+	uint8_t gap = now - glb.encTime;
+	int8_t step = 1;
+	
+	if(dir == glb.encDir){
+		if(gap < ACCEL_8){
+			step = 8;
+		} else if(gap < ACCEL_4){
+			step = 4;
+		} else if(gap < ACCEL_2){
+			step = 2;
 		}
 	}
+	
+	glb.encTime = now;
+	glb.encDir = dir;
+	
+	return dir * step;
 }
 
-// value of currently selected param has been changed: restrict parameter value within max/min limits, write to YM2612, and update LCD
-void changeValue(){
-	int* val = ym.value;
-	int op = ym.op;
+// value of currently selected param is changed by step: restrict parameter value within max/min limits, write to YM2612, and update LCD
+void changeValue(int8_t step){
+	int8_t* val = ym.value;
+	int8_t op = ym.op;
 	
 	// group 0
 	if(val == &ym.patchNum){
-		minMaxValue(&ym.patchNum,0,MAX_PRESET);
+		stepValue(&ym.patchNum,step,0,MAX_PRESET);
 		preset();
 		printToLCD(7);
 	
 	} else if(val == &ym.velSens){
-		minMaxValue(&ym.velSens,0,10);
+		stepValue(&ym.velSens,step,0,10);
+		velCurveBuild();
 		printToLCD(0);
 	
 	} else if(val == &ym.minVel){
-		minMaxValue(&ym.minVel,0,127);
+		stepValue(&ym.minVel,step,0,127);
+		velCurveBuild();
 		printToLCD(0);
 		
 	} else if(val == &ym.polyphony){
-		minMaxValue(&ym.polyphony,0,2);
+		stepValue(&ym.polyphony,step,0,2);
+		notesReset(); // poly and mono keep track of notes differently, start clean
 		printToLCD(8);
 		
+	} else if(val == &ym.bendRange){
+		stepValue(&ym.bendRange,step,0,12);
+		ym.bendChanged = true; // re-tune if the wheel isn't centered
+		printToLCD(0);
+		
+	} else if(val == &ym.userSlot){
+		stepValue(&ym.userSlot,step,0,USER_SLOTS-1);
+		userRecall();
+		printToLCD(10);
+		
+	} else if(val == &ym.saveSlot){ // only picks the slot, saving is the button chord
+		stepValue(&ym.saveSlot,step,0,USER_SLOTS-1);
+		printToLCD(10);
+		
+	} else if(val == &ym.midiChan){
+		stepValue(&ym.midiChan,step,0,16);
+		printToLCD(12);
+		
+	} else if(val == &ym.split){
+		stepValue(&ym.split,step,0,1);
+		splitChange();
+		printToLCD(9);
+		
+	} else if(val == &ym.midiChan2){
+		stepValue(&ym.midiChan2,step,1,16);
+		printToLCD(0);
+		
+	} else if(val == &ym.diag){
+		stepValue(&ym.diag,step,0,DIAG_PAGES-1);
+		printToLCD(16);
+		
+	} else if(val == &ym.part){
+		int8_t part = ym.part;
+		
+		stepValue(&part,step,0,ym.split); // only part 1 without split
+		partSelect(part);
+		ym.value = &ym.part;
+		printToLCD(13);
+		
+	} else if(val == &ym.randNum){ // any detent is a new one, which way doesn't matter
+		randomPatch();
+		printToLCD(17);
+		
+	} else if(val == &ym.drumChan){
+		bool wasOn = ym.drumChan;
+		
+		stepValue(&ym.drumChan,step,0,16);
+		if(wasOn != (bool)ym.drumChan) drumChange();
+		printToLCD(18);
+		
 	// group 1
 	} else if(val == &ym.algorithm){
-		minMaxValue(&ym.algorithm,0,7);
+		stepValue(&ym.algorithm,step,0,7);
 		writeToYM(op,ym.algorithm,ym.feedback,0xB0,0,3,0,1,0,0,0);
+		carriersUpdate();
 		printToLCD(3);
 		
 	} else if(val == &ym.feedback){
-		minMaxValue(&ym.feedback,0,7);
+		stepValue(&ym.feedback,step,0,7);
 		writeToYM(op,ym.feedback,ym.algorithm,0xB0,3,0,0,1,0,0,0);
 		printToLCD(0);
 				
 	} else if(val == &ym.multiple[op]){
-		minMaxValue(&ym.multiple[op],0,15);
+		stepValue(&ym.multiple[op],step,0,15);
 		writeToYM(op,ym.multiple[op],ym.detune[op],0x30,0,4,1,1,6,0,0);
 		printToLCD(2);
 		
 	} else if(val == &ym.detune[op]){
-		minMaxValue(&ym.detune[op],-3,3);
+		stepValue(&ym.detune[op],step,-3,3);
 		writeToYM(op,ym.detune[op],ym.multiple[op],0x30,4,0,1,1,5,0,0);
 		printToLCD(1);
 		
 	} else if(val == &ym.totalLvl[op]){
-		minMaxValue(&ym.totalLvl[op],0,127);
+		stepValue(&ym.totalLvl[op],step,0,127);
 		writeToYM(op,ym.totalLvl[op],0,0x40,0,0,1,1,9,127,0);
 		printToLCD(1);
 		
 	// group 2
 	} else if(val == &ym.attack[op]){
-		minMaxValue(&ym.attack[op],0,31);
+		stepValue(&ym.attack[op],step,0,31);
 		writeToYM(op,ym.attack[op],ym.rateScl[op],0x50,0,6,1,1,1,31,0);
 		printToLCD(1);
 		
 	} else if(val == &ym.decay[op]){
-		minMaxValue(&ym.decay[op],0,31);
+		stepValue(&ym.decay[op],step,0,31);
 		writeToYM(op,ym.decay[op],ym.amOn[op],0x60,0,7,1,1,1,31,0);
 		printToLCD(1);
 		
 	} else if(val == &ym.susLvl[op]){
-		minMaxValue(&ym.susLvl[op],0,15);
+		stepValue(&ym.susLvl[op],step,0,15);
 		writeToYM(op,ym.susLvl[op],ym.release[op],0x80,4,0,1,1,3,15,15);
 		printToLCD(1);
 		
 	} else if(val == &ym.susRate[op]){
-		minMaxValue(&ym.susRate[op],0,31);
+		stepValue(&ym.susRate[op],step,0,31);
 		writeToYM(op,ym.susRate[op],0,0x70,0,0,1,1,7,31,0); // case 7
 		printToLCD(1);
 		
 	} else if(val == &ym.release[op]){
-		minMaxValue(&ym.release[op],0,15);
+		stepValue(&ym.release[op],step,0,15);
 		writeToYM(op,ym.release[op],ym.susLvl[op],0x80,0,4,1,1,3,15,15); // case 3
 		printToLCD(1);
 		
 	} else if(val == &ym.rateScl[op]){
-		minMaxValue(&ym.rateScl[op],0,3);
+		stepValue(&ym.rateScl[op],step,0,3);
 		writeToYM(op,ym.rateScl[op],ym.attack[op],0x50,6,0,1,1,2,0,31); // case 2
 		printToLCD(1);
 		
 	} else if(val == &ym.ssgeg[op]){ // special case
-		minMaxValue(&ym.ssgeg[op],0,8);
+		stepValue(&ym.ssgeg[op],step,0,8);
 		if(ym.ssgeg[op] == 0){
 			writeToYM(op,0,0,0x90,0,3,1,1,4,0,0);
 		} else {
@@ -932,7 +2154,7 @@ void changeValue(){
 		
 	// group 3
 	} else if(val == &ym.lfoFreq){ // special case
-		minMaxValue(&ym.lfoFreq,0,8);
+		stepValue(&ym.lfoFreq,step,0,8);
 		if(ym.lfoFreq == 0){
 			writeToYM(op,0,0,0x22,0,3,0,0,0,0,0);
 		} else {
@@ -941,25 +2163,57 @@ void changeValue(){
 		printToLCD(5);
 		
 	} else if(val == &ym.vibrato){
-		minMaxValue(&ym.vibrato,0,7);
+		stepValue(&ym.vibrato,step,0,7);
 		writeToYM(op,ym.vibrato,ym.tremolo,0xB4,0,4,0,1,8,0,0); // case 8
 		printToLCD(0);
 		
 	} else if(val == &ym.tremolo){
-		minMaxValue(&ym.tremolo,0,3);
+		stepValue(&ym.tremolo,step,0,3);
 		writeToYM(op,ym.tremolo,ym.vibrato,0xB4,4,0,0,1,8,0,0); // case 8
 		printToLCD(0);
 		
 	} else if(val == &ym.amOn[op]){
-		minMaxValue(&ym.amOn[op],0,1);
+		stepValue(&ym.amOn[op],step,0,1);
 		writeToYM(op,ym.amOn[op],ym.decay[op],0x60,7,0,1,1,2,0,31); // case 2
 		printToLCD(4);
-
+		
+	} else if(val == &ym.softDest){
+		softRestore(); // the old destination goes back to the patch, softTick() takes over the new one
+		stepValue(&ym.softDest,step,0,SOFT_FEEDBACK);
+		printToLCD(15);
+		
+	} else if(val == &ym.softRate){ // these are picked up on the next tick
+		stepValue(&ym.softRate,step,0,127);
+		printToLCD(0);
+		
+	} else if(val == &ym.softDepth){
+		stepValue(&ym.softDepth,step,0,127);
+		printToLCD(0);
+		
+	} else if(val == &ym.softFade){
+		stepValue(&ym.softFade,step,0,127);
+		printToLCD(0);
+		
+	// group 4
+	} else if(ym.group == 4){
+		uint8_t src = ym.current >> 1;
+		
+		modMark(ym.modDest[src]); // the old destination goes back to its patch value
+		
+		if(val == &ym.modDest[src]){
+			stepValue(&ym.modDest[src],step,0,MOD_DESTS-1);
+			printToLCD(14);
+		} else {
+			stepValue(&ym.modDepth[src],step,-8,8);
+			printToLCD(0);
+		}
+		
+		modMark(ym.modDest[src]);
 	}
 }
 
 // return maximum of two values
-int max(int	val1, int val2){
+uint8_t max(uint8_t val1, uint8_t val2){
 	if(val1 > val2){
 		return val1;
 	} else {
@@ -967,270 +2221,1130 @@ int max(int	val1, int val2){
 	}
 }
 
-// schedule notes to be turned off or on, format data to be written to YM2612 registers A0 (freq low) and A4 (freq high + block (octave))
-void note(uint8_t noteIn, uint8_t velocity, bool on){
-	cli();
-	
-	uint16_t noteOut;
-	int oct;
-	
-	oct = noteIn / 12 - 1; // middle C is octave 5 -> make it octave 4
-	
-	minMaxValue(&oct, 0, 7); // 'block' can be 0-7 (8 octaves)
-	
-	// note frequencies within 1 octave
-	uint16_t notes[] = {311, 329, 349, 370, 392, 415, 440, 466, 493, 523, 554, 586};
-	
-	noteOut = notes[noteIn % 12]; // ex. 63 is D# -> 63 % 12 = 3 -> notes[3] = 370 (Hz)
-		
-	if(on){ // note on message has been received
-		for(int i = 0; i < 6; i++){
-			
-			// channel is not on and is not waiting to be turned on
-			if(!ym.notesOn[i][1] && !ym.notesOn[i][2]){
-				
-				ym.vel[i] = max(velocity, ym.minVel); // velocity can't be lower than minVel or else it'll all be too quiet maybe or something
-				
-				// format pitch to be written to YM2612
-				ym.freq[i][0] = (oct<<3) | ((noteOut & 0x0700)>>8); // top 3 bits of freq, next 3 bits are octave
-				ym.freq[i][1] = (noteOut & 0x00FF); // lower 8 bits of freq
-				
-				ym.notesOn[i][0] = noteIn; 
-				ym.notesOn[i][1] = 1; // schedule note to be turned on
-				
-				break; // only loop until finding first available channel
-				
-			// if it is already on but the note is the same value, turn channel off and then on again
-			} else if(ym.notesOn[i][1] && ym.notesOn[i][2] && ym.notesOn[i][0] == noteIn){
-				uint8_t chanGrp = (i > 2); // 0 or 1, depending on value of i
-				
-				sendreg(0, 0x28, 0x00+chan[i]);
-				
-				sendreg(chanGrp, 0xA4+i%3, ym.freq[i][0]);
-				sendreg(chanGrp, 0xA0+i%3, ym.freq[i][1]);
-				
-				sendreg(0, 0x28, 0xF0+chan[i]);
-				
-				break;
-			}
-		}
-	} else { // key is released
-		for(uint8_t i = 0; i < 6; ++i){
-			// find matching key in notesOn, only turn off if it is not waiting to be turned off
-			if(ym.notesOn[i][1] && ym.notesOn[i][2] && ym.notesOn[i][0] == noteIn){
-				
-				ym.notesOn[i][1] = 0; // schedule corresponding channel to be turned off
-				
-				break;
-			}
-		}
+// velocity curve: how much to turn the carriers down for each velocity, so voiceOn() doesn't have to work it out
+// velSens 0 ignores velocity, 10 turns a note at velocity 0 all the way down; anything below minVel counts as minVel
+void velCurveBuild(){
+	uint8_t vel;
+	
+	for(uint8_t i = 0; i < VEL_STEPS; i++){
+		vel = max((i << 1) | 1, ym.minVel); // middle of the 2 velocities this entry covers
+		ym.velCurve[i] = (ym.velSens * (127 - vel)) / 10;
 	}
-	
-	sei();
 }
 
-// receive MIDI messages and translate (note on, note off, pitch, modulation, etc)
-ISR(USART_RX_vect){
-	glb.sreg = SREG;
-	cli();
-	
-	int data = UDR0; // data coming into RX pin
+// the algorithm changed: operators that were carriers and aren't anymore still have velocity-scaled levels
+// on channels that have played, so those get the patch level again (the shadow drops any that already have it)
+void carriersUpdate(){
+	uint8_t old = ym.carriers;
 	
-	// the 2 data bytes after the status message (sometimes only 1 is used)
-	int data1;
-	int data2;
+	ym.carriers = pgm_read_byte(&carrierMask[ym.algorithm]);
 	
-	if(data < 0xF8){ // >= 0xF8 - system control messages, not used
-		glb.midiBuf[glb.midiIndex] = data;
-		
-		// status messages start 1XXX XXXX, all others 0XXX XXXX
-		if((data & 0xF0) >= 0x80) glb.msgStart = glb.midiIndex;
-		
-		glb.midiIndex++; // move forward in midi data buffer
-		
-		minMaxValue(&glb.midiIndex, 0, 127);
-	}
-		
-	bool case1 = 0;
-	bool case2 = 0;
+	partBurst(ym.part);
 	
-	// my way of creating a ring buffer, since midi messages are up to 3 bytes long
-	if(glb.msgStart == 127){
-		data1 = glb.midiBuf[0];
-		data2 = glb.midiBuf[1];
-		case1 = 1;
-	} else if(glb.msgStart == 126){
-		data1 = glb.midiBuf[127];
-		data2 = glb.midiBuf[0];
-		case2 = 1;
-	} else {
-		data1 = glb.midiBuf[glb.msgStart+1];
-		data2 = glb.midiBuf[glb.msgStart+2];
+	for(int o = 0; o < 4; o++){
+		if((old & ~ym.carriers) & (1<<o)) chanAdd(0x40+opOffset[o], 127 - ym.totalLvl[o]);
 	}
 	
-	// if message is 3 bytes long (note on/off, controller, etc)
-	if((glb.midiIndex - glb.msgStart == 3) || (glb.midiIndex == 2 && case1) || (glb.midiIndex == 1 && case2)){
-		switch(glb.midiBuf[glb.msgStart] & 0xF0){ // upper nibble of status byte is status message, lower nibble is midi channel (not currently used)
-			case 0x90: // note on: status byte - note number - velocity	
-				note(data1,data2,1);
-				break;
-			case 0x80: // note off: status byte - note number - note off velocity	
-				note(data1,data2,0);
-				break;
-			case 0xA0: // poly AT
-				// unused
-				break;
-			case 0xB0: // controllers (mod wheel etc): status byte - controller number - data
-				if(data1 == 1){ // mod wheel is controller 1, currently only used for LFO frequency
-					if(data2 == 0){ // reset to original LFO value when mod wheel is not in use
-						if(ym.lfoFreq == 0){
-							sendreg(0,0x22,0);
-						} else {
-							sendreg(0,0x22,0x08+ym.lfoFreq-1);
-						}
-					} else { // 127 / 8 = 18
-						sendreg(0,0x22,0x08+(data2/18));
-					}
-				
-				} else if(data1 == 64){ // sustain
-					if(data2 == 0){
-						ym.sustain = true;
-					} else {
-						ym.sustain = false;
-					} 
-				}
-				
-				break;
-			case 0xC0: // program change (probably won't use)
-				//
-				break;
-		}
+	burstEnd();
+}
+
+// look up the A4 (block + freq high) and A0 (freq low) values for a note, bent by bendOffset 64ths of a semitone
+// the note table gives the unbent F-number, the bend moves it to a lower note plus a fraction of a semitone
+// which is multiplied in from bendRatio[] (fixed point, no floats)
+void noteFreq(uint8_t noteIn, int16_t bendOffset, volatile uint8_t* freq){
+	int16_t pitch = ((int16_t)(noteIn & 0x7F) << 6) + bendOffset;
+	uint8_t block;
+	uint16_t fnum;
+	
+	if(pitch < 0) pitch = 0;
+	if(pitch > (127 << 6)) pitch = 127 << 6;
+	
+	freq[0] = pgm_read_byte(&noteTable[pitch >> 6][0]);
+	freq[1] = pgm_read_byte(&noteTable[pitch >> 6][1]);
+	
+	if(pitch & 0x3F){ // in between notes
+		block = freq[0] >> 3;
+		fnum = ((uint16_t)(freq[0] & 0x07) << 8) | freq[1];
+		fnum = ((uint32_t)fnum * pgm_read_word(&bendRatio[pitch & 0x3F])) >> 15;
 		
-	// message is 2 bytes (aftertouch, pitch bend)
-	} else if((glb.midiIndex - glb.msgStart == 2) || (glb.midiIndex == 1 && case1) || (glb.midiIndex == 0 && case2)){
-		switch(glb.midiBuf[glb.msgStart] & 0xF0){
-			case 0xD0: // aftertouch, currently only used for vibrato
-				if(data1 == 0){ // if 0, restore old values
-					for(int i = 0; i < 3; i++){ // write to all 6 channels
-						for(int j = 0; j < 2; j++){
-							sendreg(j, 0xB4+i, 0xC0 + (ym.tremolo<<4) + ym.vibrato); // register is shared with tremolo and panning 
-						}
-					}
-				} else {
-					for(int i = 0; i < 3; i++){
-						for(int j = 0; j < 2; j++){
-							sendreg(j, 0xB4+i, 0xC0 + (ym.tremolo<<4) + data1/18);
-						}
-					}
-				}
-				break;
-				
-			case 0xE0: // pitch bend (kinda wonky, use it to turn all notes off instead for now)
-				for(int i = 0; i < 6; i++){
-					sendreg(0, 0x28, 0x00+chan[i]);
-					ym.notesOn[i][0] = 0;
-					ym.notesOn[i][1] = 0;
-					ym.notesOn[i][2] = 0;
-				}
-					/*
-					if(data1 == 0){
-						for(int i = 0; i < 6; i++){
-							sendreg((i > 2), 0xA0 + i%3, ym.freq[1][i]);
-						}
-					} else {
-						for(int i = 0; i < 6; i++){
-							sendreg((i > 2), 0xA0 + i%3, ym.freq[1][i] + data1);
-						}
-					}
-					*/
-				break;
+		if(fnum > 0x7FF){ // F-number only has 11 bits, move up a block
+			if(block < 7){
+				fnum >>= 1;
+				++block;
+			} else {
+				fnum = 0x7FF;
+			}
 		}
+		
+		freq[0] = (block << 3) | (fnum >> 8);
+		freq[1] = fnum & 0xFF;
 	}
-	
-	SREG = glb.sreg;
 }
 
-// when the timer overflows, turn on or off any notes (channels) that are waiting to be turned off or on
-ISR(TIMER1_OVF_vect){
-	glb.sreg = SREG;
-	cli();
+// pitch bend amount in 64ths of a semitone, scaled by the bend range
+int16_t bendOffset(){
+	return ((int32_t)ym.bend * ym.bendRange * 64) >> 13;
+}
+
+// turn notes off or on, look up data to be written to YM2612 registers A0 (freq low) and A4 (freq high + block (octave))
+// part 2 (split) has no note-to-channel map of its own, with only 3 channels noteScan() just looks through them
+// the mono modes only apply to part 1, part 2 is always polyphonic
+void note(uint8_t noteIn, uint8_t velocity, bool on, uint8_t part){
+	noteIn &= 0x7F; // MIDI notes are 0-127
+	
+	if(on && (glb.pendingValid & (1<<part))) pendingLoad(part); // new patch goes in before the first note that uses it
 	
-	uint8_t chanGrp;
-	int opLvl;
+	if(ym.polyphony && part == 0){ // mono retrig or mono legato
+		noteMono(noteIn, velocity, on);
+		return;
+	}
+	
+	uint8_t i = part ? noteScan(noteIn) : noteVoiceGet(noteIn); // channel already playing this note, if any
 	
-	for(int i = 0; i < 6; i++){
-		chanGrp = (i > 2);
+	if(on){ // note on message has been received
+		if(i == NO_VOICE) i = sustainedGet(noteIn, part);
 		
-		// turn notes on 
-		if(ym.notesOn[i][1] && !ym.notesOn[i][2]){ // note is currently off but should be on
+		if(i == NO_VOICE){
+			i = voiceAlloc(part);
 			
-			// FOR VELOCITY
+			ym.vel[i] = velocity; // minVel is taken care of by the velocity curve
 			
-			for(int o = 0; o < 4; o++){
-				// velocity sensitivity: more sensitivity means output leans more and more toward velocity when averaging
-				opLvl = ((ym.velSens)*ym.vel[i] + (10-ym.velSens)*ym.totalLvl[o]) / 10;
-				
-				// each operator's level becomes the average of the selected level and velocity input
-				sendreg(chanGrp, 0x40+i%3+opOffset[o], 127 - opLvl);
-			}
+			// pitch to be written to YM2612 comes from the note table, with the current pitch bend
+			// freq[i][0] is the top 3 bits of freq + octave, freq[i][1] the lower 8 bits of freq
+			noteFreq(noteIn, bendOffset(), ym.freq[i]);
 			
+			ym.notesOn[i][0] = noteIn; 
+			ym.notesOn[i][1] = 1;
 			
-			// set frequency high/low registers
-			sendreg(chanGrp, 0xA4+i%3, ym.freq[i][0]);
-			sendreg(chanGrp, 0xA0+i%3, ym.freq[i][1]);
+			if(!part) noteVoiceSet(noteIn, i);
+			voiceTouch(i);
 			
-			// turn note on
-			sendreg(0, 0x28, 0xF0+chan[i]);
+			voiceOn(i);
 			
-			// flag to indicate that note is indeed on
-			ym.notesOn[i][2] = 1;
+		// still ringing from the pedal: same channel again, restarted with the new velocity
+		} else if(!ym.notesOn[i][1]){
+			ym.sustained &= ~(1<<i);
+			ym.notesOn[i][1] = 1;
+			ym.vel[i] = velocity;
 			
-		// turn notes off
-		} else if(!ym.notesOn[i][1] && ym.notesOn[i][2]){ // note is currently on but should be off
+			if(!part) noteVoiceSet(noteIn, i);
+			voiceTouch(i);
 			
-			if(!ym.sustain){ // see how this goes
-				// turn note off
-				sendreg(0, 0x28, 0x00+chan[i]);
+			sendreg(0, 0x28, 0x00+chan[i]);
+			voiceOn(i);
+			
+		// if it is already on, turn channel off and then on again
+		} else if(ym.notesOn[i][2]){
+			uint8_t chanGrp = (i > 2); // 0 or 1, depending on value of i
+			
+			sendreg(0, 0x28, 0x00+chan[i]);
+			
+			sendreg(chanGrp, 0xA4+i%3, ym.freq[i][0]);
+			sendreg(chanGrp, 0xA0+i%3, ym.freq[i][1]);
+			
+			sendreg(0, 0x28, 0xF0+chan[i]);
+			
+			voiceTouch(i);
+		}
+	} else if(i != NO_VOICE){ // key is released
+		voiceRelease(i);
+		
+		if(!part) noteVoiceSet(noteIn, NO_VOICE);
+		voiceTouch(i);
+	}
+}
+
+// mono modes: the held notes are kept on monoStack and channel 1 always plays the last one pressed
+// releasing the playing note goes back to the previous held note, releasing the last one turns the channel off
+// called from note()
+void noteMono(uint8_t noteIn, uint8_t velocity, bool on){
+	uint8_t i;
+	bool wasPlaying = ym.monoCount && (ym.monoStack[ym.monoCount-1] == noteIn);
+	
+	// take the note out of the stack if it's already in it
+	for(i = 0; i < ym.monoCount; i++){
+		if(ym.monoStack[i] == noteIn) break;
+	}
+	if(i < ym.monoCount){
+		for(; i < ym.monoCount - 1; i++) ym.monoStack[i] = ym.monoStack[i+1];
+		--ym.monoCount;
+	}
+	
+	if(on){
+		// stack full: forget the oldest held note
+		if(ym.monoCount == MONO_STACK){
+			for(i = 0; i < MONO_STACK - 1; i++) ym.monoStack[i] = ym.monoStack[i+1];
+			--ym.monoCount;
+		}
+		ym.monoStack[ym.monoCount++] = noteIn;
+		
+		ym.vel[0] = velocity; // only used if the note gets turned on again (not legato)
+		
+		// legato only if there's already a key held down, otherwise every note starts fresh
+		monoPlay(noteIn, (ym.polyphony == 2) && ym.notesOn[0][1]);
+		
+	} else if(wasPlaying){ // only the note that's playing matters when it's released
+		if(ym.monoCount){
+			monoPlay(ym.monoStack[ym.monoCount-1], ym.polyphony == 2); // back to the last held note
+		} else {
+			voiceRelease(0); // nothing held anymore
+		}
+	}
+}
+
+// play a note on the mono channel (channel 1)
+// legato: only the frequency registers are written (A4/A0), the envelope keeps going
+// retrig: the channel is turned off and on again with the new note, restarting the envelope
+void monoPlay(uint8_t noteIn, bool legato){
+	ym.notesOn[0][0] = noteIn;
+	ym.notesOn[0][1] = 1;
+	ym.sustained &= ~(1<<0); // held again, not the pedal's anymore
+	ym.voiceFree &= ~(1<<0);
+	
+	if(legato && ym.notesOn[0][2]){
+		noteFreq(noteIn, bendOffset() + glb.softPitch[0], ym.freq[0]); // the soft LFO keeps going across legato notes
+		
+		sendreg(0, 0xA4, ym.freq[0][0]);
+		sendreg(0, 0xA0, ym.freq[0][1]);
+	} else {
+		noteFreq(noteIn, bendOffset(), ym.freq[0]);
+		if(ym.notesOn[0][2]) sendreg(0, 0x28, 0x00+chan[0]);
+		voiceOn(0);
+	}
+}
+
+// turn every channel off and forget all held notes, in both the poly and mono bookkeeping
+void notesReset(){
+	for(uint8_t i = 0; i < 6; i++){
+		sendreg(0, 0x28, 0x00+chan[i]);
+		ym.notesOn[i][0] = 0;
+		ym.notesOn[i][1] = 0;
+		ym.notesOn[i][2] = 0;
+	}
+	
+	ym.voiceFree = 0x3F;
+	ym.sustained = 0;
+	memset((void*)ym.noteVoice, (NO_VOICE << 4) | NO_VOICE, sizeof(ym.noteVoice));
+	ym.monoCount = 0;
+}
+
+// pick the channel for a new note, in order of preference:
+//  - a free channel: the one released the longest ago, so its release has had the most time to fade
+//  - the oldest sustained channel (released, but still sounding because of the pedal)
+//  - the oldest held channel
+// a stolen channel is turned off right away so it can be turned back on with the new note
+// only the part's channels are looked at
+uint8_t voiceAlloc(uint8_t part){
+	uint8_t mask = partMask(part);
+	uint8_t voice;
+	int8_t i;
+	
+	if(ym.voiceFree & mask){
+		for(i = 0; i < 6; i++){
+			voice = ym.voiceAge[i];
+			if(ym.voiceFree & mask & (1<<voice)){
+				ym.voiceFree &= ~(1<<voice);
+				return voice;
+			}
+		}
+	}
+	
+	// sustained channels if there are any, otherwise held ones
+	if(ym.sustained & mask) mask &= ym.sustained;
+	
+	for(i = 0; i < 6; i++){
+		voice = ym.voiceAge[i];
+		if(mask & (1<<voice)) break;
+	}
+	
+	// steal it
+	if(ym.notesOn[voice][2]) sendreg(0, 0x28, 0x00+chan[voice]);
+	if(noteVoiceGet(ym.notesOn[voice][0]) == voice) noteVoiceSet(ym.notesOn[voice][0], NO_VOICE);
+	
+	ym.sustained &= ~(1<<voice);
+	ym.notesOn[voice][1] = 0;
+	ym.notesOn[voice][2] = 0;
+	
+	return voice;
+}
+
+// turn a channel on: carrier levels for its velocity, frequency, then key on
+// everything goes straight into the SPI queue, so the key on is out as soon as the bytes ahead of it are
+void voiceOn(uint8_t voice){
+	uint8_t carriers = pgm_read_byte(&carrierMask[glb.parts[voicePart(voice)].algFb & 0x07]);
+	uint8_t chanGrp = (voice > 2); // 0 or 1, depending on value of voice
+	uint8_t dest;
+	
+	// the soft LFO starts over for every note, at 0 (so nothing to add to the pitch or levels yet)
+	glb.softPhase[voice] = 0;
+	glb.softFade[voice] = ym.softFade ? 0 : 255;
+	glb.softPitch[voice] = 0;
+	
+	voiceLevel(voice, 0);
+	
+	// velocity modulation is different for every note, so the channel's destination is set here
+	// (the LFO is global, that one is left to controlTick())
+	dest = ym.modDest[MOD_VEL];
+	if(dest == MOD_BRIGHT){
+		for(int o = 0; o < 4; o++){
+			if(!(carriers & (1<<o))) sendreg(chanGrp, 0x40+voice%3+opOffset[o], modValue(dest, voice, o));
+		}
+	} else if(dest > MOD_LFO){
+		sendreg(chanGrp, (dest == MOD_FEEDBACK ? 0xB0 : 0xB4)+voice%3, modValue(dest, voice, 0));
+	}
+	
+	// set frequency high/low registers
+	sendreg(chanGrp, 0xA4+voice%3, ym.freq[voice][0]);
+	sendreg(chanGrp, 0xA0+voice%3, ym.freq[voice][1]);
+	
+	// turn note on
+	sendreg(0, 0x28, 0xF0+chan[voice]);
+	
+	ym.notesOn[voice][2] = 1; // flag to indicate that note is indeed on
+}
+
+// carrier levels for a channel's velocity, plus extra (the soft LFO), the modulators stay at the patch level
+uint8_t voiceLevel(uint8_t voice, uint8_t extra){
+	const struct Patch* patch = &glb.parts[voicePart(voice)];
+	uint8_t carriers = pgm_read_byte(&carrierMask[patch->algFb & 0x07]);
+	uint16_t atten = ym.velCurve[ym.vel[voice] >> 1] + extra;
+	uint16_t tl;
+	uint8_t writes = 0;
+	
+	for(int o = 0; o < 4; o++){
+		if(!(carriers & (1<<o))) continue;
+		
+		// the patch's total level, made quieter by the velocity curve (127 is silent)
+		tl = patch->tl[o] + atten;
+		if(tl > 127) tl = 127;
+		
+		writes += sendreg((voice > 2), 0x40+voice%3+opOffset[o], tl);
+	}
+	
+	return writes;
+}
+
+// turn a channel off, clear its note number and flags, and give it back to voiceAlloc()
+void voiceOff(uint8_t voice){
+	sendreg(0, 0x28, 0x00+chan[voice]);
+	
+	ym.notesOn[voice][0] = 0;
+	ym.notesOn[voice][1] = 0;
+	ym.notesOn[voice][2] = 0;
+	
+	ym.sustained &= ~(1<<voice);
+	ym.voiceFree |= (1<<voice); // free for the next note
+}
+
+// a channel's key has come up: off now, or with the pedal down, marked sustained for sustainRelease()
+void voiceRelease(uint8_t voice){
+	ym.notesOn[voice][1] = 0;
+	
+	if(ym.sustain){
+		ym.sustained |= (1<<voice);
+	} else {
+		voiceOff(voice);
+	}
+}
+
+// sustain has come up: channels whose keys were released while it was down are turned off now, all in one go
+void sustainRelease(){
+	for(uint8_t i = 0; ym.sustained; i++){
+		if(ym.sustained & (1<<i)) voiceOff(i); // clears the bit
+	}
+}
+
+// sustained channel in a part that's playing a note (key up, still sounding), NO_VOICE if none
+uint8_t sustainedGet(uint8_t noteIn, uint8_t part){
+	uint8_t bits = ym.sustained & partMask(part);
+	
+	for(uint8_t i = 0; bits; i++, bits >>= 1){
+		if((bits & 1) && ym.notesOn[i][0] == noteIn) return i;
+	}
+	
+	return NO_VOICE;
+}
+
+// channel 4-6 held down playing a note, NO_VOICE if none
+uint8_t noteScan(uint8_t noteIn){
+	for(uint8_t i = 3; i < 6; i++){
+		if(ym.notesOn[i][1] && ym.notesOn[i][0] == noteIn) return i;
+	}
+	
+	return NO_VOICE;
+}
+
+// move a channel to the end (newest) of voiceAge
+void voiceTouch(uint8_t voice){
+	uint8_t i = 0;
+	
+	while(ym.voiceAge[i] != voice) ++i;
+	
+	for(; i < 5; i++) ym.voiceAge[i] = ym.voiceAge[i+1];
+	
+	ym.voiceAge[5] = voice;
+}
+
+// channel playing a note, NO_VOICE if none
+uint8_t noteVoiceGet(uint8_t noteIn){
+	uint8_t both = ym.noteVoice[noteIn >> 1];
+	
+	return (noteIn & 1) ? both >> 4 : both & 0x0F;
+}
+
+// set the channel playing a note (NO_VOICE to clear it)
+void noteVoiceSet(uint8_t noteIn, uint8_t voice){
+	uint8_t both = ym.noteVoice[noteIn >> 1];
+	
+	if(noteIn & 1){
+		both = (both & 0x0F) | (voice << 4);
+	} else {
+		both = (both & 0xF0) | voice;
+	}
+	
+	ym.noteVoice[noteIn >> 1] = both;
+}
+
+// take the bytes the USART_RX ISR has received out of the ring buffer and put messages together
+// handles running status (data bytes without a status byte reuse the last one), 1 and 2 data byte messages,
+// and realtime bytes (0xF8+) showing up in the middle of a message, which are skipped without breaking it
+// system exclusive data goes to streamByte(), and while the stream queue is full the rest of the bytes are left
+// in the MIDI buffer until there's room, so whatever is sending the stream can get ahead by both of them
+void midiParse(){
+	uint8_t data;
+	uint8_t length;
+	
+	while(glb.midiTail != glb.midiHead){
+		if(glb.streamSysex && (uint8_t)(glb.streamHead - glb.streamTail) == STREAM_QUEUE_SIZE) break;
+		
+		data = glb.midiBuf[glb.midiTail & MIDI_QUEUE_MASK];
+		++glb.midiTail;
+		
+		if(data >= 0xF8){ // realtime messages (clock etc), not used, and don't affect running status
+			continue;
+		}
+		
+		if(data >= 0xF0){ // system common: sysex start/end etc, these cancel running status
+			glb.midiSysex = (data == 0xF0);
+			glb.streamSysex = false;
+			glb.midiStatus = 0;
+			glb.midiCount = 0;
+			continue;
+		}
+		
+		if(data & 0x80){ // status byte: start of a new message
+			if(glb.streamOn) streamCancel(); // whatever was sending the stream stopped without ending it
+			glb.midiSysex = false;
+			glb.streamSysex = false;
+			glb.midiStatus = data;
+			glb.midiCount = 0;
+			continue;
+		}
+		
+		// data byte
+		if(glb.midiSysex){
+			streamByte(data);
+			continue;
+		}
+		
+		if(!glb.midiStatus) continue; // no status to go with it
+		
+		glb.midiData[glb.midiCount++] = data;
+		
+		// program change and channel aftertouch have 1 data byte, everything else 2
+		length = ((glb.midiStatus & 0xE0) == 0xC0) ? 1 : 2;
+		
+		if(glb.midiCount == length){
+			glb.msgTime = glb.midiTime[(uint8_t)(glb.midiTail - 1) & MIDI_QUEUE_MASK]; // the byte just taken out
+			if(!glb.streamOn) midiMessage(glb.midiStatus, glb.midiData[0], glb.midiData[1]);
+			glb.midiCount = 0; // status stays, for running status
+		}
+	}
+}
+
+// act on complete MIDI messages and translate (note on, note off, pitch, modulation, etc)
+// data2 is left over from an earlier message for 1 data byte messages
+void midiMessage(uint8_t status, uint8_t data1, uint8_t data2){
+	uint8_t part = midiPart(status & 0x0F);
+	
+	// the drum channel only plays samples, even if it's also a channel the FM parts listen to
+	if(ym.drumChan && (status & 0x0F) == ym.drumChan - 1){
+		if((status & 0xF0) == 0x90 && data2) drumNote(data1, data2);
+		return;
+	}
+	
+	if(part == NO_PART) return; // not on a channel that's listened to
+	
+	switch(status & 0xF0){ // upper nibble of status byte is status message, lower nibble is midi channel
+		case 0x90: // note on: status byte - note number - velocity
+			if(data2 == 0){ // note on with velocity 0 is a note off (sent a lot with running status)
+				note(data1,data2,0,part);
+			} else {
+				glb.modSrc[MOD_VEL] = data2;
+				if(ym.modDest[MOD_VEL] == MOD_LFO) modMark(MOD_LFO); // channels get theirs in voiceOn()
 				
-				// clear channel's note number, set both flags to 0 to indicate that note is off
-				ym.notesOn[i][0] = 0;
-				ym.notesOn[i][1] = 0;
-				ym.notesOn[i][2] = 0;
+				note(data1,data2,1,part);
+				latencyRecord();
+			}
+			break;
+		case 0x80: // note off: status byte - note number - note off velocity
+			note(data1,data2,0,part);
+			break;
+		case 0xA0: // poly AT
+			// unused
+			break;
+		case 0xB0: // controllers (mod wheel etc): status byte - controller number - data
+			if(data1 == 1){ // mod wheel is controller 1, sent on the next control tick
+				glb.modSrc[MOD_WHEEL] = data2;
+				modMark(ym.modDest[MOD_WHEEL]);
+			
+			} else if(data1 == 0){ // bank select, for program change
+				glb.bankMsb = data2;
+			} else if(data1 == 32){
+				glb.bankLsb = data2;
+			} else if(data1 == 64){ // sustain: 64 and up is down
+				if(data2 >= 64){
+					ym.sustain = true;
+				} else if(ym.sustain){
+					ym.sustain = false;
+					sustainRelease();
+				}
 			}
+			
+			break;
+		case 0xC0: // program change: status byte - program number
+			programChange(data1, part);
+			break;
+		case 0xD0: // aftertouch: status byte - pressure, sent on the next control tick like the mod wheel
+			glb.modSrc[MOD_AT] = data1;
+			modMark(ym.modDest[MOD_AT]);
+			break;
+		case 0xE0: // pitch bend: status byte - LSB - MSB (14 bits)
+			// only store it, controlTick() re-tunes the channels so a bend sweep sends at most one A4/A0 pair per channel per tick
+			ym.bend = (((int16_t)data2 << 7) | data1) - 8192;
+			ym.bendChanged = true;
+			break;
+	}
+}
+
+// register stream: the chip can be played straight from a computer, like a VGM player.  the commands go into the
+// stream queue here, the timer1 compare B ISR plays them (streamRun()) with timing to the cycle, and their writes
+// go around the register shadow, so when the stream ends it starts over and the parts' patches are loaded again
+//
+// a data byte of a system exclusive message (midiCount is 0 at the first one): the first byte is the manufacturer ID,
+// and if it's STREAM_ID the rest are register stream commands, anyone else's sysex is ignored (and ends a stream)
+// the commands are VGM's YM2612 commands squeezed into 7 bits, so a VGM file can be sent as it's played by
+// breaking it up into sysex messages - VGM's own waits (0x61-0x63) all become STREAM_CMD_WAIT:
+//  - STREAM_CMD_WRITE | port << 2 | reg bit 7 << 1 | data bit 7, reg, data: VGM 0x52/0x53
+//  - STREAM_CMD_WAIT, low, high: wait up to 16383 samples
+//  - STREAM_CMD_SHORT | n: wait n + 1 samples (VGM 0x7n)
+//  - STREAM_CMD_END: the stream is over
+// a command can be split between two messages, and one that isn't finished by the end of the last message is lost
+// midiParse() makes sure there's room in the stream queue before it hands a byte over
+void streamByte(uint8_t data){
+	volatile uint8_t* entry;
+	uint8_t cmd;
+	
+	if(!glb.streamSysex){
+		if(glb.midiCount) return; // not the first byte, or not a stream
+		glb.midiCount = 1;
+		
+		if(data == STREAM_ID){
+			glb.streamSysex = true;
+			if(!glb.streamOn) streamBegin();
+		} else if(glb.streamOn){
+			streamCancel(); // someone else's sysex, the stream isn't coming back
 		}
+		return;
+	}
+	
+	glb.streamCmd[glb.streamCount++] = data;
+	cmd = glb.streamCmd[0];
+	
+	if((cmd & 0x70) == STREAM_CMD_WRITE || (cmd & 0x70) == STREAM_CMD_WAIT){
+		if(glb.streamCount < 3) return;
+	}
+	glb.streamCount = 0;
+	
+	entry = glb.streamBuf[glb.streamHead & STREAM_QUEUE_MASK];
+	
+	switch(cmd & 0x70){
+		case STREAM_CMD_WRITE:
+			entry[0] = (cmd >> 2) & 0x01; // sendreg() flag
+			entry[1] = glb.streamCmd[1] | (cmd & 0x02) << 6;
+			entry[2] = glb.streamCmd[2] | (cmd & 0x01) << 7;
+			break;
+		case STREAM_CMD_WAIT:
+			entry[0] = STREAM_WAIT;
+			entry[1] = glb.streamCmd[1] | glb.streamCmd[2] << 7;
+			entry[2] = glb.streamCmd[2] >> 1;
+			break;
+		case STREAM_CMD_SHORT:
+			entry[0] = STREAM_WAIT;
+			entry[1] = (cmd & 0x0F) + 1;
+			entry[2] = 0;
+			break;
+		case STREAM_CMD_END:
+			entry[0] = STREAM_END;
+			break;
+		default: // not a command
+			return;
 	}
 	
-	SREG = glb.sreg;
+	++glb.streamHead;
+	streamKick();
 }
 
-// everything related to encoder and buttons happens here
-ISR(PCINT2_vect){	
-	glb.sreg = SREG;
+// the stream writes straight to the chip without the shadow, so from here on the shadow can't be trusted,
+// and nothing that's playing is left on - the stream's first wait is timed from now
+void streamBegin(){
+	notesReset();
+	memset(glb.shadowValid, 0, sizeof(glb.shadowValid));
+	
+	glb.streamOn = true;
+	glb.streamCount = 0;
+	glb.streamDue = clockNow();
+	glb.streamFrac = 0;
+}
+
+// streamRun() played STREAM_END: forget the shadow again and put back what the stream might have changed,
+// starting with channel 6 (DAC) and channel 3 (special mode and the timers, 0x27)
+// unless another stream is already queued up behind it, then that one just carries on
+void streamStop(){
+	glb.streamEnded = false;
+	
+	if(glb.streamTail != glb.streamHead){
+		streamKick();
+		return;
+	}
+	
+	glb.streamOn = false;
+	memset(glb.shadowValid, 0, sizeof(glb.shadowValid));
+	
+	drumChange(); // every channel off, and the DAC back to how the drum channel wants it
+	sendreg(0, 0x27, 0x00);
+	
+	patchEncode(&glb.parts[ym.part]);
+	patchLoad(&glb.parts[0], 0);
+	if(ym.split) patchLoad(&glb.parts[1], 1);
+}
+
+// a channel message or another sysex came in the middle of a stream, so the sender gave up on it without an
+// end command: what's still queued is thrown away and the chip goes back to the patches, same as the end
+void streamCancel(){
+	uint8_t sreg = SREG;
+	cli();
+	
+	TIMSK1 &= ~(1<<OCIE1B);
+	glb.streamTail = glb.streamHead;
+	glb.streamEnded = false;
+	
+	SREG = sreg;
+	
+	streamStop();
+}
+
+// nothing is playing (the queue ran out, or a stream just began) but there's something in the stream queue:
+// turn on the compare B interrupt and play whatever's due right away
+// waits are timed from when the one before was due, not from when the commands came in, so a sender that's a
+// little late doesn't make the stream drift - but if it's more than STREAM_SLACK late the stream fell behind,
+// and it starts again from now instead of trying to catch up
+void streamKick(){
+	uint8_t sreg = SREG;
+	
+	if((TIMSK1 & (1<<OCIE1B)) || glb.streamEnded || glb.streamTail == glb.streamHead) return;
+	
+	cli();
+	
+	if((int32_t)(clockNow() - glb.streamDue) > STREAM_SLACK){
+		glb.streamDue = clockNow();
+		glb.streamFrac = 0;
+	}
+	
+	TIFR1 = (1<<OCF1B); // an old match doesn't count
+	TIMSK1 |= (1<<OCIE1B);
+	streamRun();
+	
+	SREG = sreg;
+}
+
+// play the stream until the next wait that isn't up yet: the writes before it go out as bursts, one per run of
+// writes to the same port, and a wait moves streamDue on by its samples and sets timer1's compare B to it
+// a wait longer than a timer1 overflow just has the compare match a few times before it's really due
+// called with interrupts off, from the compare B ISR or streamKick()
+void streamRun(){
+	uint8_t frame[2 + 2*STREAM_BURST];
+	volatile uint8_t* entry;
+	uint8_t count;
+	uint32_t wait;
+	
+	while(1){
+		if((int32_t)(clockNow() - glb.streamDue) < 0){
+			OCR1B = (uint16_t)glb.streamDue;
+			
+			// if timer1 went past it while the compare was being set, it won't match until the next time around
+			if((int32_t)(clockNow() - glb.streamDue) < 0) return;
+		}
+		
+		if(glb.streamTail == glb.streamHead) break; // ran out, streamKick() starts it again
+		
+		entry = glb.streamBuf[glb.streamTail & STREAM_QUEUE_MASK];
+		
+		if(entry[0] == STREAM_WAIT){
+			wait = ((uint16_t)entry[2] << 8 | entry[1]) * STREAM_STEP + glb.streamFrac;
+			glb.streamDue += wait >> 6;
+			glb.streamFrac = wait & 0x3F;
+			++glb.streamTail;
+			continue;
+		}
+		
+		if(entry[0] == STREAM_END){
+			++glb.streamTail;
+			glb.streamEnded = true;
+			break;
+		}
+		
+		// writes, as many in a row to the same port as fit
+		frame[0] = FRAME_BURST | entry[0];
+		count = 0;
+		
+		do {
+			frame[2 + 2*count] = entry[1];
+			frame[3 + 2*count] = entry[2];
+			++count;
+			++glb.streamTail;
+			
+			entry = glb.streamBuf[glb.streamTail & STREAM_QUEUE_MASK];
+		} while(count < STREAM_BURST && glb.streamTail != glb.streamHead && entry[0] == (frame[0] & 0x03));
+		
+		if(count == 1){
+			frame[1] = frame[0] & 0x03; // a single write, same as burstEnd()
+			spiQueue(&frame[1], 3);
+		} else {
+			frame[1] = count;
+			spiQueue(frame, 2 + 2*count);
+		}
+	}
+	
+	TIMSK1 &= ~(1<<OCIE1B);
+}
+
+// MIDI byte received: just put it in the ring buffer for midiParse()
+ISR(USART_RX_vect){
+	uint16_t start = TCNT1;
+	uint8_t status = UCSR0A; // has to be read before UDR0
+	uint8_t data = UDR0; // data coming into RX pin
+	
+	if(status & (1<<DOR0)) ++glb.midiOverrun; // a byte before this one was lost
+	
+	if(status & (1<<FE0)){ // no stop bit, the byte is garbage
+		++glb.midiFrameErr;
+	} else if((uint8_t)(glb.midiHead - glb.midiTail) < MIDI_QUEUE_SIZE){
+		glb.midiBuf[glb.midiHead & MIDI_QUEUE_MASK] = data;
+		glb.midiTime[glb.midiHead & MIDI_QUEUE_MASK] = clockStamp();
+		++glb.midiHead;
+		
+		if((uint8_t)(glb.midiHead - glb.midiTail) > glb.midiHigh) glb.midiHigh = glb.midiHead - glb.midiTail;
+	} else {
+		++glb.midiDropped;
+	}
+	
+	ISR_TIME(ISR_MIDI, start);
+}
+
+// cycles since power up: timer1 counts the low 16 bits, its overflows the high 16
+// runs ~4.5 minutes before wrapping, which is fine for measuring time differences
+uint32_t clockNow(){
+	uint8_t sreg = SREG;
 	cli();
 	
+	uint16_t low = TCNT1;
+	uint16_t high = glb.clockHigh;
+	
+	// overflowed but the ISR hasn't run yet (interrupts are off, or this is an ISR)
+	if((TIFR1 & (1<<TOV1)) && low < 0x8000) ++high;
+	
+	SREG = sreg;
+	
+	return ((uint32_t)high << 16) | low;
+}
+
+// clockNow() in 32 us units, 16 bits
+uint16_t clockStamp(){
+	return clockNow() >> STAMP_SHIFT;
+}
+
+// a note on was just acted on: its key on is the last frame queued, so it's out when spiTail gets to spiHead as
+// it is now.  if the queue is already empty it went out in the meantime (or the note on didn't need a frame)
+// when all the slots are waiting, this one isn't counted
+void latencyRecord(){
+	uint8_t sreg = SREG;
+	cli();
+	
+	if(glb.spiTail == glb.spiHead){
+		latencyDone(glb.msgTime);
+	} else if((uint8_t)(glb.latencyHead - glb.latencyTail) < LATENCY_SLOTS){
+		glb.latencyMark[glb.latencyHead & LATENCY_MASK] = glb.spiHead;
+		glb.latencyStart[glb.latencyHead & LATENCY_MASK] = glb.msgTime;
+		++glb.latencyHead;
+	}
+	
+	SREG = sreg;
+}
+
+// how long ago did the last byte of the note on come in
+void latencyDone(uint16_t start){
+	glb.latency = clockStamp() - start;
+	
+	if(glb.latency > glb.latencyMax) glb.latencyMax = glb.latency;
+	if(glb.latency < glb.latencyMin) glb.latencyMin = glb.latency;
+	glb.latencyAvg += glb.latency - (glb.latencyAvg >> 3); // each new one counts for 1/8th
+}
+
+// reset the min/max numbers and high-water marks, and the lost MIDI counts
+void diagClear(){
+	glb.latencyMin = 0xFFFF;
+	glb.latencyMax = 0;
+	glb.latencyAvg = 0;
+	glb.spiHigh = 0;
+	glb.midiHigh = 0;
+	glb.midiDropped = 0;
+	glb.midiOverrun = 0;
+	glb.midiFrameErr = 0;
+	glb.slaveLost = 0;
+	memset(glb.isrMax, 0, sizeof(glb.isrMax));
+}
+
+// once per timer1 overflow (4.1 ms), from the main loop
+void controlTick(){
+	// a second has gone by: SPI traffic in it, and the diagnostics page gets the new numbers
+	if(++glb.secTicks == TICKS_PER_SEC){
+		glb.secTicks = 0;
+		glb.spiFrameRate = glb.spiFrames;
+		glb.spiByteRate = glb.spiBytes;
+		glb.spiFrames = 0;
+		glb.spiBytes = 0;
+		
+		if(ym.value == &ym.diag) printToLCD(16); // only the characters that changed get sent
+	}
+	
+	// pitch bend has moved since the last tick: re-tune every channel that's on
+	// frequencies that come out the same aren't sent again
+	if(ym.bendChanged){
+		int16_t offset = bendOffset();
+		uint8_t newFreq[2];
+		
+		ym.bendChanged = false;
+		
+		for(int i = 0; i < 6; i++){
+			if(!ym.notesOn[i][2]) continue;
+			
+			noteFreq(ym.notesOn[i][0], offset + glb.softPitch[i], newFreq);
+			
+			if(newFreq[0] == ym.freq[i][0] && newFreq[1] == ym.freq[i][1]) continue;
+			
+			ym.freq[i][0] = newFreq[0];
+			ym.freq[i][1] = newFreq[1];
+			
+			sendreg((i > 2), 0xA4+i%3, ym.freq[i][0]);
+			sendreg((i > 2), 0xA0+i%3, ym.freq[i][1]);
+		}
+	}
+	
+	// one modulation destination per tick, taking turns, however many controller messages came in
+	// (not while a register stream has the chip, streamStop() marks them all again anyway)
+	if(glb.modDirty && !glb.streamOn){
+		do {
+			glb.modNext = glb.modNext % (MOD_DESTS - 1) + 1; // 1 to MOD_DESTS-1, MOD_OFF is never marked
+		} while(!(glb.modDirty & (1<<glb.modNext)));
+		
+		glb.modDirty &= ~(1<<glb.modNext);
+		modApply(glb.modNext);
+	}
+}
+
+// a destination's sources changed - MOD_OFF is nothing to update
+void modMark(uint8_t dest){
+	if(dest != MOD_OFF) glb.modDirty |= 1<<dest;
+}
+
+// the patch values under the modulation were just written, put it back on top
+void modMarkAll(){
+	for(uint8_t s = 0; s < MOD_SOURCES; s++) modMark(ym.modDest[s]);
+}
+
+// how far every source routed to dest moves it: amount (0-127) * depth (-8 to 8), scaled so one source at
+// full amount and depth is modRange[dest].  vel stands in for the velocity source (a channel's own, or the last note's)
+int16_t modDelta(uint8_t dest, uint8_t vel){
+	int16_t sum = 0;
+	
+	for(uint8_t s = 0; s < MOD_SOURCES; s++){
+		if(ym.modDest[s] != dest) continue;
+		
+		sum += (int16_t)(s == MOD_VEL ? vel : glb.modSrc[s]) * ym.modDepth[s];
+	}
+	
+	return ((int32_t)sum * pgm_read_byte(&modRange[dest])) / (127 * 8);
+}
+
+// keep a modulated value within 0-max
+uint8_t modClamp(int16_t val, uint8_t max){
+	if(val < 0) return 0;
+	if(val > max) return max;
+	return val;
+}
+
+// register value for one channel of a per channel destination: the channel's part's patch value, moved by the sources
+// only the bits for the destination change, so panning/tremolo/algorithm in the same register stay as they are
+// op is only used for brightness, which turns the level of one modulator down (brighter) or up
+uint8_t modValue(uint8_t dest, uint8_t voice, uint8_t op){
+	const struct Patch* patch = &glb.parts[voicePart(voice)];
+	int16_t delta = modDelta(dest, ym.vel[voice]);
+	
+	switch(dest){
+		case MOD_VIBRATO:
+			return (patch->lfoSens & 0xF8) | modClamp((patch->lfoSens & 0x07) + delta, 7);
+		case MOD_AMS:
+			return (patch->lfoSens & 0xCF) | (modClamp((patch->lfoSens >> 4 & 0x03) + delta, 3) << 4);
+		case MOD_FEEDBACK:
+			return (patch->algFb & 0xC7) | (modClamp((patch->algFb >> 3 & 0x07) + delta, 7) << 3);
+		default: // MOD_BRIGHT
+			return modClamp(patch->tl[op] - delta, 127);
+	}
+}
+
+// bring a destination up to date on every channel (or the global LFO register)
+void modApply(uint8_t dest){
+	uint8_t vals[6];
+	uint8_t mask;
+	
+	if(dest == MOD_LFO){ // global, so it's the edited part's LFO moved by the last note's velocity
+		uint8_t lfo = glb.parts[ym.part].lfo;
+		uint8_t freq = modClamp(((lfo & 0x08) ? (lfo & 0x07) + 1 : 0) + modDelta(dest, glb.modSrc[MOD_VEL]), 8); // 0 is off, like ym.lfoFreq
+		
+		sendreg(0, 0x22, freq ? 0x08 | (freq - 1) : 0);
+		
+	} else if(dest == MOD_BRIGHT){ // every operator that isn't a carrier on that channel
+		for(uint8_t o = 0; o < 4; o++){
+			mask = 0;
+			
+			for(uint8_t v = 0; v < 6; v++){
+				if(pgm_read_byte(&carrierMask[glb.parts[voicePart(v)].algFb & 0x07]) & (1<<o)) continue; // velocity's
+				
+				vals[v] = modValue(dest, v, o);
+				mask |= 1<<v;
+			}
+			
+			modSend(0x40 + opOffset[o], vals, mask);
+		}
+		
+	} else {
+		for(uint8_t v = 0; v < 6; v++) vals[v] = modValue(dest, v, 0);
+		
+		modSend(dest == MOD_FEEDBACK ? 0xB0 : 0xB4, vals, 0x3F);
+	}
+}
+
+// write vals[i] to reg of channel i for the channels in mask
+// if that's all 6 channels with the same value, it's one broadcast pair (4 bytes) instead of 6 frames
+// either way the shadow drops the channels that already have their value
+void modSend(uint8_t reg, const uint8_t* vals, uint8_t mask){
+	bool same = (mask == 0x3F);
+	
+	for(uint8_t v = 1; v < 6 && same; v++){
+		if(vals[v] != vals[0]) same = false;
+	}
+	
+	if(same){
+		burstBegin(FRAME_BCAST);
+		burstAdd(reg, vals[0]);
+		burstEnd();
+		return;
+	}
+	
+	for(uint8_t v = 0; v < 6; v++){
+		if(mask & (1<<v)) sendreg((v > 2), reg+v%3, vals[v]);
+	}
+}
+
+// soft LFO: the YM2612's own LFO only has 8 rates and is the same for every channel, so this one moves a phase
+// per channel (restarted at every key on) through a sine table and writes it to the channel's pitch, carrier
+// levels or feedback
+// move every channel along by however many ticks went by, then write as many channels as the
+// budget allows, starting from the one that didn't get a turn last time
+// phases keep moving even when nothing is written, so a busy tick only makes it late, not slow
+void softTick(uint8_t ticks){
+	uint16_t inc = ((uint16_t)ym.softRate * ym.softRate / 4 + ym.softRate) * ticks; // 0 to 4159 per tick, 16 Hz
+	uint8_t fadeInc = ym.softFade ? ((128 - ym.softFade) >> 2) + 1 : 255; // 1 to 32 per tick
+	uint8_t writes = 0;
+	uint8_t v;
+	
+	for(v = 0; v < 6; v++){
+		glb.softPhase[v] += inc;
+		glb.softFade[v] = (255 - glb.softFade[v] > fadeInc * ticks) ? glb.softFade[v] + fadeInc * ticks : 255;
+	}
+	
+	if(ym.softDest == SOFT_OFF) return;
+	
+	// notes and controllers come first, let the queue empty out
+	if((uint8_t)(glb.spiHead - glb.spiTail) > SPI_QUEUE_SIZE/2) return;
+	
+	for(uint8_t n = 0; n < 6 && writes < SOFT_BUDGET; n++){
+		v = glb.softVoice;
+		glb.softVoice = (v == 5) ? 0 : v + 1;
+		
+		if(ym.notesOn[v][2]) writes += softWrite(v);
+	}
+}
+
+// sine wave from the quarter in sineTable[]
+int8_t softSine(uint8_t phase){
+	uint8_t i = phase & 0x3F;
+	int8_t val;
+	
+	if(phase & 0x40) i = 64 - i; // second and fourth quarter go back down
+	val = pgm_read_byte(&sineTable[i]);
+	
+	return (phase & 0x80) ? -val : val; // second half is negative
+}
+
+// the soft LFO's value for a channel, sent to its destination - only what changed gets written
+// pitch goes up to +-2 semitones, levels up to 31 steps (23 dB) quieter, feedback +-7
+uint8_t softWrite(uint8_t voice){
+	uint8_t phase = glb.softPhase[voice] >> 8;
+	uint8_t chanGrp = (voice > 2);
+	int16_t amount;
+	
+	if(ym.softDest == SOFT_LEVEL){ // 0 at the start of the cycle so a note starts at its level, then down and back up
+		amount = 127 - softSine(phase + 64);
+		amount = (((amount * ym.softDepth) >> 8) * glb.softFade[voice]) >> 10; // 0 to 31
+		
+		return voiceLevel(voice, amount);
+	}
+	
+	amount = (((int16_t)softSine(phase) * ym.softDepth) >> 7) * glb.softFade[voice] >> 8; // -127 to 127
+	
+	if(ym.softDest == SOFT_PITCH){
+		uint8_t newFreq[2];
+		
+		if(amount == glb.softPitch[voice]) return 0;
+		glb.softPitch[voice] = amount;
+		
+		noteFreq(ym.notesOn[voice][0], bendOffset() + amount, newFreq);
+		
+		if(newFreq[0] == ym.freq[voice][0] && newFreq[1] == ym.freq[voice][1]) return 0;
+		
+		// A4 goes into a latch all the port's channels share, so it always goes out right before A0
+		ym.freq[voice][0] = newFreq[0];
+		ym.freq[voice][1] = newFreq[1];
+		sendreg(chanGrp, 0xA4+voice%3, newFreq[0]);
+		sendreg(chanGrp, 0xA0+voice%3, newFreq[1]);
+		
+		return 2;
+	}
+	
+	// SOFT_FEEDBACK, on top of the mod matrix
+	uint8_t algFb = modValue(MOD_FEEDBACK, voice, 0);
+	
+	return sendreg(chanGrp, 0xB0+voice%3, (algFb & 0xC7) | (modClamp((algFb >> 3 & 0x07) + amount / 18, 7) << 3));
+}
+
+// the soft LFO destination is changing: the old one gets the values it would have without it
+void softRestore(){
+	switch(ym.softDest){
+		case SOFT_PITCH:
+			memset(glb.softPitch, 0, sizeof(glb.softPitch));
+			ym.bendChanged = true; // controlTick() re-tunes the channels
+			break;
+		case SOFT_LEVEL:
+			for(uint8_t v = 0; v < 6; v++) voiceLevel(v, 0);
+			break;
+		case SOFT_FEEDBACK:
+			modMark(MOD_FEEDBACK); // modApply() writes every channel's feedback
+			break;
+	}
+}
+
+// timer1 overflowed: top half of clockNow(), and the main loop takes it as the control tick
+ISR(TIMER1_OVF_vect){
+	uint16_t start = TCNT1;
+	
+	++glb.clockHigh;
+	
+	ISR_TIME(ISR_TIMER1, start);
+}
+
+// timer1 compare B: the next register stream entry might be due
+ISR(TIMER1_COMPB_vect){
+	uint16_t start = TCNT1;
+	
+	streamRun();
+	
+	ISR_TIME(ISR_STREAM, start);
+}
+
+// timer0 compare match, 250 Hz: the main loop runs softTick() for every one of these
+ISR(TIMER0_COMPA_vect){
+	uint16_t start = TCNT1;
+	
+	++glb.softTicks;
+	
+	ISR_TIME(ISR_TIMER0, start);
+}
+
+// the last byte put in SPDR is done sending, send the next one (if there is one)
+ISR(SPI_STC_vect){
+	uint16_t start = TCNT1;
+	
+	spiNext();
+	
+	ISR_TIME(ISR_SPI, start);
+}
+
+// encoder and buttons: work out what happened and add it to the events for uiUpdate()
+// nothing is written to the YM2612 or the screen from here
+ISR(PCINT2_vect){	
+	uint16_t start = TCNT1;
+	
 	// get current pin values
 	uint8_t RPG[] = {(PIND & (1<<ENC_A))>>ENC_A, (PIND & (1<<ENC_B))>>ENC_B}; // current pin values for individual encoder pins
 	uint8_t RPGpin = PIND & ((1<<ENC_A) | (1<<ENC_B)); // current overall encoder status
 	
 	uint8_t BTN_L_status = (PIND & (1<<BTN_L))>>BTN_L; // current value for left button pin
 	uint8_t BTN_R_status = (PIND & (1<<BTN_R))>>BTN_R; // right button pin
-
+	
+	uint8_t now = (uint8_t)glb.clockHigh;
+	int16_t sum; // accelerated value total, before keeping it within int8_t
 	
 	// if the thing that caused the interrupt was either button going low, cleared to change group
 	if(!BTN_L_status || !BTN_R_status) glb.chgGrp = true;
 	
 	if(glb.RPGpinOld == RPGpin){
 		// if interrupt was caused by button change and not RPG:
-		if(glb.chgGrp){
+		// a release right after the last one is the contacts bouncing
+		// releasing one button while the other is held is the save chord instead of a group change
+		if(glb.chgGrp && !glb.chord && (uint8_t)(now - glb.btnTime) >= DEBOUNCE_TICKS){
 			if(BTN_L_status && !glb.BTN_L_old){ // button has just been released
-				--ym.group;
-				changeGroup();
+				if(!BTN_R_status){
+					glb.uiSave = true;
+					glb.chord = true;
+				} else {
+					--glb.uiGroup;
+				}
+				glb.btnTime = now;
 			}
 			if(BTN_R_status && !glb.BTN_R_old){
-				++ym.group;
-				changeGroup();
+				if(!BTN_L_status){
+					glb.uiSave = true;
+					glb.chord = true;
+				} else {
+					++glb.uiGroup;
+				}
+				glb.btnTime = now;
 			}
 		}
+		if(BTN_L_status && BTN_R_status) glb.chord = false; // both up, back to normal
+		
 		// store pin values
 		glb.BTN_L_old = BTN_L_status;
 		glb.BTN_R_old = BTN_R_status;
@@ -1240,25 +3354,23 @@ ISR(PCINT2_vect){
 		if(RPG[1] && !RPG[0]){ // limit number of cases so that value only changes once per turn (as opposed to 4 times)
 			if ((glb.RPGold[1] == RPG[0]) && (glb.RPGold[0] != RPG[1])){ // encoder turned counterclockwise
 				if(!BTN_L_status){ // if encoder button is held
-					--ym.current; // change currently selected parameter (decrement)
-					changeCurrent();
+					--glb.uiCurrent; // change currently selected parameter (decrement)
 				} else if(!BTN_R_status){ // other button is held
-					--ym.op; // change currently selected operator
-					changeCurrent();
-				} else if(BTN_L_status && BTN_R_status){ // neither button is held
-					--*ym.value; // change value of currently selected parameter
-					changeValue();
+					--glb.uiOp; // change currently selected operator
+				} else if(glb.uiValue > -127){ // neither button is held
+					--glb.uiValue; // change value of currently selected parameter (decrement)
+					sum = glb.uiAccel + accelStep(-1, now);
+					glb.uiAccel = (sum < -127) ? -127 : sum;
 				}
 			} else if ((glb.RPGold[0] == RPG[1]) && (glb.RPGold[1] != RPG[0])){ // encoder turned clockwise
 				if(!BTN_L_status){
-					++ym.current;
-					changeCurrent();
+					++glb.uiCurrent;
 				} else if(!BTN_R_status){
-					++ym.op;
-					changeCurrent();
-				} else if(BTN_L_status && BTN_R_status){
-					++*ym.value;
-					changeValue();
+					++glb.uiOp;
+				} else if(glb.uiValue < 127){
+					++glb.uiValue;
+					sum = glb.uiAccel + accelStep(1, now);
+					glb.uiAccel = (sum > 127) ? 127 : sum;
 				}
 			}
 		}
@@ -1271,5 +3383,5 @@ ISR(PCINT2_vect){
 		glb.BTN_R_old = BTN_R_status;
 	}
 	
-	SREG = glb.sreg;
+	ISR_TIME(ISR_PCINT, start);
 }
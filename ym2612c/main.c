@@ -15,6 +15,34 @@
  * and writes the data to the appropriate register in the YM2612 after each 3rd
  * byte.  the first signifies which channels will be written to, the second
  * is the register, and the 3rd is the data to write
+ *
+ * besides the single 3 byte writes, the main controller can send bursts (same
+ * definitions in megamega1.c):
+ *  - FRAME_BURST | flag, count, count x (reg, data): several writes to the same port(s)
+ *  - FRAME_BCAST, count, count x (reg, data): each data byte is written to reg+0,
+ *    reg+1 and reg+2 on both ports, i.e. the same value for channels 1-6
+ *
+ * the SPI ISR only collects the bytes: each complete write is pushed into a FIFO,
+ * and the main loop takes frames out of the FIFO and writes them to the YM2612,
+ * so the slow register writes never hold up the SPI receiver
+ *
+ * each register write is a handful of plain port writes: the control port states
+ * for every combination of A0/A1 are worked out once at start up, and the waits
+ * between bus writes are the datasheet's, in YM2612 clock cycles
+ *
+ * drum samples (samples.h) are played through the YM2612's DAC on channel 6: a
+ * FRAME_DAC (FRAME_DAC, sample, velocity) is picked out by the SPI ISR right away
+ * instead of going through the FIFO, and the main loop writes the next sample to
+ * 0x2A every time timer2's compare flag comes up (8 kHz), before any FM write
+ * that's waiting.  the address only has to be written again if an FM write
+ * came in between (on either port, they share one address latch)
+ *
+ * the main controller holds SS low for exactly one frame, so every SS change
+ * (pin change interrupt on PB2) means the next byte is a header: if a byte
+ * went missing, only that frame is lost instead of every write after it
+ * landing in the wrong register.  frames lost either way are counted and sent
+ * back on MISO (spiStatus()), so the main controller knows its shadow of the
+ * YM2612's registers can't be trusted any more
  */
 ///////////////////////////////////////////////////////////////////////////// 
 
@@ -24,6 +52,7 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include <util/delay.h>
 #include <avr/power.h>
 #include <stdlib.h>
@@ -31,6 +60,8 @@
 #include <string.h>
 #include <stdbool.h>
 
+#include "samples.h"
+
 // ym control pins
 #define CS PC0
 #define WR PC1
@@ -65,6 +96,55 @@
 #define YM_IC_PORT PORTB
 #define YM_CTRL_PORT PORTC
 #define YM_DATA_PORT PORTD
+#define YM_DATA_PIN PIND
+
+// whether to read the YM2612's busy flag (bit 7 of the status register, read with RD low)
+// after each data write, or fall back to fixed delays long enough for the slowest register
+#ifndef YM_USE_BUSY_BIT
+#define YM_USE_BUSY_BIT 0
+#endif
+
+// busy flag polls before giving up, in case RD isn't connected - about 80us, far past the longest busy time
+#define YM_BUSY_TIMEOUT 255
+
+// YM2612 bus timing - the waits are in YM2612 clock cycles, the clock being OC1A (16 MHz toggled every cycle)
+#define YM_CLOCK 8000000UL
+#define YM_CYCLES_US(n) ((n) * 1000000.0 / YM_CLOCK)
+#define YM_ADDR_WAIT 17 // address write to data write
+#define YM_DATA_WAIT 83 // data write to the next address write, registers 0x21-0x9E
+#define YM_DATA_WAIT_FAST 47 // same, registers 0xA0-0xB6
+#define YM_WRITE_PULSE 0.2 // us WR has to stay low (the data is set up before it goes low, and held for a cycle after)
+
+// DAC sample rate, timer2 in CTC mode with prescale 8: 16 MHz / 8 / 250 = 8 kHz
+#define DAC_RATE 8000UL
+#define DAC_REG 0x2A
+
+// SPI frame headers - a first byte below 0x80 is the flag of a single 3 byte write
+#define FRAME_BURST 0x80 // | flag: count, then count (reg, data) pairs for the port(s) in flag
+#define FRAME_BCAST 0xC0 // count, then count (reg, data) pairs, each written to channels 1-6
+#define FRAME_DAC 0xE0 // sample number (NUM_SAMPLES or more stops), velocity 0-127: play a sample through the DAC
+
+// positions within a frame (glb.inCnt)
+#define IN_HEADER 0
+#define IN_COUNT 1
+#define IN_REG 2
+#define IN_DATA 3
+#define IN_DAC_NUM 4
+#define IN_DAC_VEL 5
+
+// FIFO flag for a broadcast write: reg+0..2 on both ports
+#define FLAG_BCAST 3
+
+// received frame FIFO - must be a power of 2 so the indexes can wrap with a mask
+#define FIFO_SIZE 64
+#define FIFO_MASK (FIFO_SIZE - 1)
+
+// one complete register write received from the main controller
+struct Frame {
+	uint8_t flag;
+	uint8_t reg;
+	uint8_t data;
+};
 
 struct Global {
 	uint8_t sreg;
@@ -74,16 +154,48 @@ struct Global {
 	uint8_t writeFlag;
 	
 	uint8_t inCnt;
+	uint8_t burstLeft; // (reg, data) pairs still to come in the current frame
+	
+	// frames are added at fifoHead by the SPI ISR and written to the YM2612 from fifoTail by the main loop
+	volatile struct Frame fifo[FIFO_SIZE];
+	volatile uint8_t fifoHead;
+	volatile uint8_t fifoTail;
+	volatile uint8_t fifoDropped; // frames lost because the FIFO was full
+	volatile uint8_t resyncs; // frames still open when SS went high, i.e. bytes went missing
+	// both of those go back to the main controller, see spiStatus()
+	
+	// YM_CTRL_PORT values, set once in main() so a bus write never has to read-modify-write the port
+	uint8_t ctrlIdle; // CS, WR, RD high
+	uint8_t ctrlSel[4]; // CS low and WR high, for A1 << 1 | A0 (A1 is the port, A0 is data rather than address)
+	uint8_t ctrlRead; // CS and RD low, A0 = A1 = 0: status register
+	
+	// DAC: the SPI ISR leaves the request, dacTick() in the main loop plays it
+	volatile bool dacReq;
+	volatile uint8_t dacReqNum;
+	volatile uint8_t dacReqVel;
+	const uint8_t* dacPos; // next sample byte, in flash
+	uint16_t dacLeft; // samples still to play
+	uint8_t dacVel;
+	bool dacAddr; // the address latch (one for both ports) still holds port 0's DAC_REG, so a sample is just a data write
 };
 	
 struct Global glb;
 
 void setreg(uint8_t reg, uint8_t data, uint8_t chan);
-void ymWrite(uint8_t data);
+void ymPair(uint8_t port, uint8_t reg, uint8_t data);
+void ymDac(uint8_t data);
+void dacTick(void);
 void setreg123(uint8_t reg, uint8_t data);
 void setreg456(uint8_t reg, uint8_t data);
+#if YM_USE_BUSY_BIT
+void ymWaitReady(void);
+#endif
+
+void spiByte(uint8_t in);
+static inline uint8_t spiStatus(void);
 
 ISR(SPI_STC_vect);
+ISR(PCINT0_vect);
 
 int main(void){		
 	// DDR setup
@@ -98,6 +210,10 @@ int main(void){
 	// initialize SPI
 	SPCR = (1<<SPIE) | (1<<SPE);
 	
+	// pin change interrupt on SS (PCINT2) to find the start of each frame
+	PCMSK0 = (1<<PCINT2);
+	PCICR = (1<<PCIE0);
+	
 	// initialize timer1
 	TCCR1A = (1<<COM1A0);
 	TCCR1B = (1<<CS10) | (1<<WGM12);
@@ -106,8 +222,22 @@ int main(void){
 	
 	TCNT1 = 0;
 	
+	// initialize timer2: DAC sample clock, only its compare flag is used (polled by the main loop, no interrupt)
+	TCCR2A = (1<<WGM21);
+	TCCR2B = (1<<CS21);
+	OCR2A = F_CPU / 8 / DAC_RATE - 1;
+	
 	// initialize global vars
-	glb.inCnt = 0;
+	glb.inCnt = IN_HEADER;
+	glb.burstLeft = 0;
+	glb.fifoHead = 0;
+	glb.fifoTail = 0;
+	glb.fifoDropped = 0;
+	glb.resyncs = 0;
+	SPDR = spiStatus();
+	glb.dacReq = false;
+	glb.dacLeft = 0;
+	glb.dacAddr = false;
 		
 	// initialize YM ctrl pins
 	YM_IC_PORT |= (1<<IC);
@@ -119,6 +249,17 @@ int main(void){
 	YM_IC_PORT |= (1<<IC);
 	_delay_ms(10);
 	
+	// control port states, keeping whatever else is on the port (IC on the breadboard version)
+	uint8_t base = YM_CTRL_PORT & ~((1<<CS) | (1<<WR) | (1<<RD) | (1<<A0) | (1<<A1));
+	
+	glb.ctrlIdle = base | (1<<CS) | (1<<WR) | (1<<RD);
+	for(uint8_t i = 0; i < 4; i++){
+		glb.ctrlSel[i] = base | (1<<WR) | (1<<RD) | ((i & 1) ? (1<<A0) : 0) | ((i & 2) ? (1<<A1) : 0);
+	}
+	glb.ctrlRead = base | (1<<WR);
+	
+	YM_CTRL_PORT = glb.ctrlIdle;
+	
 	// init register setup
 	setreg123(0x22, 0x00); // LFO off
 	setreg123(0x27, 0x00); // Note off (channel 0)
@@ -165,14 +306,25 @@ int main(void){
 	sei();
 	  
     while (1){
-		// program is handled by SPI interrupt
+		// a DAC sample is due: it goes first, FM writes fit in between samples
+		// (the flag stays up until this clears it, and one FM write is much shorter than a sample period)
+		if(TIFR2 & (1<<OCF2A)){
+			TIFR2 = (1<<OCF2A); // cleared by writing a 1
+			dacTick();
+			
+		// write any frames the SPI interrupt has received
+		} else if(glb.fifoTail != glb.fifoHead){
+			volatile struct Frame* frame = &glb.fifo[glb.fifoTail & FIFO_MASK];
+			
+			setreg(frame->reg, frame->data, frame->flag);
+			++glb.fifoTail; // slot is free again for the ISR
+		}
     }
 }
 
 // set registers in YM2612
+// only ever called from the main loop, so the SPI interrupt can keep receiving while this runs
 void setreg(uint8_t reg, uint8_t data, uint8_t chan){
-	cli();
-	
 	switch(chan){
 		case 0: // just set channels 1-3
 		setreg123(reg, data);
@@ -180,70 +332,227 @@ void setreg(uint8_t reg, uint8_t data, uint8_t chan){
 		case 1: // just channels 4-6
 		setreg456(reg, data);
 		break;
+		case FLAG_BCAST: // same value for channel 1-3 registers on both ports (all 6 channels)
+		for(uint8_t i = 0; i < 3; i++){
+			setreg123(reg + i, data);
+			setreg456(reg + i, data);
+		}
+		break;
 		default: // set all 6
 		setreg123(reg, data);
 		setreg456(reg, data);
 		break;
 	}
-	
-	sei();
 }
 
 // to write to chan 1-3: A0,A1 = 0,0 for reg select; 1,0 for data write
 void setreg123(uint8_t reg, uint8_t data){
-	YM_CTRL_PORT &= ~(1<<A0); // channels 1-3
-	ymWrite(reg);
-	YM_CTRL_PORT |= (1<<A0);
-	ymWrite(data);
-	YM_CTRL_PORT &= ~(1<<A0);
+	ymPair(0, reg, data);
 }
 
 // to write to chan 4-6: A0,A1 = 0,1 for reg select, 1,1 for data write
 void setreg456(uint8_t reg, uint8_t data){
-	YM_CTRL_PORT |= (1<<A1); // channels 4-6
-	ymWrite(reg);
-	YM_CTRL_PORT |= (1<<A0);
-	ymWrite(data);
-	YM_CTRL_PORT &= ~((1<<A0) | (1<<A1));
+	ymPair(1, reg, data);
 }
 
-void ymWrite(uint8_t data){
-	YM_CTRL_PORT &= ~(1<<CS);
+// one byte onto the YM2612 bus with the control lines in sel (CS low, WR high): four port writes and the
+// minimum WR pulse, which is as quick as the bus allows at 16 MHz (an interrupt in here only makes a pulse longer)
+static inline void ymBus(uint8_t sel, uint8_t data){
 	YM_DATA_PORT = data;
-	_delay_us(1);	
-	YM_CTRL_PORT &= ~(1<<WR);
-	//YM_CTRL_PORT |= (1<<RD); // ???
-	_delay_us(5);
-	YM_CTRL_PORT |= (1<<WR);
-	//YM_CTRL_PORT &= ~(1<<RD); // ????
-	_delay_us(5);
-	YM_CTRL_PORT |= (1<<CS);
-	
-	// TODO: maybe play with setting RD
+	YM_CTRL_PORT = sel; // CS low and A0/A1 set a cycle before WR goes low
+	YM_CTRL_PORT = sel & ~(1<<WR);
+	_delay_us(YM_WRITE_PULSE);
+	YM_CTRL_PORT = sel; // WR high, the YM2612 takes the byte
+	YM_CTRL_PORT = glb.ctrlIdle;
+}
+
+// after a data write: whatever wait the register needs before the next address write
+static inline void ymDataWait(uint8_t reg){
+#if YM_USE_BUSY_BIT
+	(void)reg;
+	ymWaitReady();
+#else
+	if(reg >= 0xA0){
+		_delay_us(YM_CYCLES_US(YM_DATA_WAIT_FAST));
+	} else {
+		_delay_us(YM_CYCLES_US(YM_DATA_WAIT));
+	}
+#endif
+}
+
+// address then data to one port
+void ymPair(uint8_t port, uint8_t reg, uint8_t data){
+	ymBus(glb.ctrlSel[port << 1], reg);
+	_delay_us(YM_CYCLES_US(YM_ADDR_WAIT));
+	ymBus(glb.ctrlSel[(port << 1) | 1], data);
+	
+	// both ports share one address latch, so a port 1 address write replaces DAC_REG too
+	glb.dacAddr = (port == 0 && reg == DAC_REG);
+	
+	ymDataWait(reg);
+}
+
+// one DAC sample: the address is only written if any other register was written since the last one
+void ymDac(uint8_t data){
+	if(!glb.dacAddr){
+		ymBus(glb.ctrlSel[0], DAC_REG);
+		_delay_us(YM_CYCLES_US(YM_ADDR_WAIT));
+		glb.dacAddr = true;
+	}
+	
+	ymBus(glb.ctrlSel[1], data); // A0 high, A1 low: port 0 data
+	ymDataWait(DAC_REG);
+}
+
+// timer2 came around: start a sample if one was asked for, then write the next byte of the one playing
+// a new sample cuts off the one before it, there's only the one DAC
+void dacTick(void){
+	if(glb.dacReq){
+		uint8_t num = glb.dacReqNum;
+		
+		glb.dacReq = false;
+		glb.dacVel = glb.dacReqVel;
+		
+		if(num < NUM_SAMPLES){
+			glb.dacPos = pgm_read_ptr(&samples[num].data);
+			glb.dacLeft = pgm_read_word(&samples[num].length);
+		} else if(glb.dacLeft){ // stop
+			glb.dacLeft = 0;
+			ymDac(0x80);
+		}
+	}
+	
+	if(!glb.dacLeft) return;
+	
+	// signed around 0x80, scaled by velocity
+	int8_t sample = pgm_read_byte(glb.dacPos++) ^ 0x80;
+	--glb.dacLeft;
+	
+	ymDac(((sample * glb.dacVel) >> 7) ^ 0x80);
+}
+
+#if YM_USE_BUSY_BIT
+// read the status register (A0 = A1 = 0, CS and RD low) until the busy flag clears, so each write only waits
+// as long as that register actually needs
+void ymWaitReady(void){
+	uint8_t tries = YM_BUSY_TIMEOUT;
+	
+	YM_DATA_DDR = 0x00; // let the YM2612 drive the data bus
+	YM_DATA_PORT = 0x00; // no pull-ups
+	YM_CTRL_PORT = glb.ctrlRead;
+	_delay_us(0.25); // read access time
+	
+	while((YM_DATA_PIN & (1<<7)) && --tries);
+	
+	YM_CTRL_PORT = glb.ctrlIdle;
+	YM_DATA_DDR = 0xFF; // back to writing
+}
+#endif
+
+// what goes back to the main controller with the next byte: the frames lost so far (fifoDropped + resyncs),
+// 4 bits of it in the low nibble and the same 4 bits inverted in the high nibble, so a byte that isn't from here
+// (MISO not connected, or SPDR wasn't loaded in time and the received byte went back out) doesn't count
+static inline uint8_t spiStatus(void){
+	uint8_t lost = (glb.fifoDropped + glb.resyncs) & 0x0F;
+	
+	return lost | (~lost << 4);
 }
 
 // receive data over SPI
+// the status goes into SPDR first thing, so it's loaded before the main controller starts the next byte
 ISR(SPI_STC_vect){
+	uint8_t in;
+	
 	glb.sreg = SREG;
 	cli();
 	
+	in = SPDR;
+	SPDR = spiStatus();
+	spiByte(in);
+	
+	SREG = glb.sreg;
+};
+
+// SS went high (end of a frame) or low (start of one): either way the next byte is a header
+// this has priority over the SPI interrupt, so a byte may already be waiting: the frame's last one if SS went high,
+// the next frame's header if it went low
+ISR(PCINT0_vect){
+	if(PINB & (1<<SS)){
+		if(SPSR & (1<<SPIF)){
+			spiByte(SPDR);
+		}
+		
+		// only a frame that's still open when SS goes high was cut short
+		if(glb.inCnt != IN_HEADER){
+			++glb.resyncs;
+			glb.inCnt = IN_HEADER;
+		}
+	} else {
+		// the last frame was closed (or counted) on the way up, so whatever state is left isn't a lost frame
+		glb.inCnt = IN_HEADER;
+		
+		if(SPSR & (1<<SPIF)){
+			spiByte(SPDR);
+		}
+	}
+	
+	SPDR = spiStatus(); // with a resync counted, for the next byte
+}
+
+// one byte of a frame
+// the header decides how the rest of the frame is read: a plain flag means one (reg, data) pair follows,
+// a burst header is followed by a count and then that many (reg, data) pairs
+void spiByte(uint8_t in){
 	switch(glb.inCnt){
-		case 0: // first value written determines which channels will be written to
-			glb.writeFlag = SPDR;
+		case IN_HEADER: // first value written determines which channels will be written to
+			if(in == FRAME_DAC){
+				glb.inCnt = IN_DAC_NUM;
+			} else if(in == FRAME_BCAST){
+				glb.writeFlag = FLAG_BCAST;
+				glb.inCnt = IN_COUNT;
+			} else if(in & FRAME_BURST){
+				glb.writeFlag = in & 0x03;
+				glb.inCnt = IN_COUNT;
+			} else {
+				glb.writeFlag = in;
+				glb.burstLeft = 1;
+				glb.inCnt = IN_REG;
+			}
+			break;
+		case IN_COUNT: // number of (reg, data) pairs in the burst
+			glb.burstLeft = in;
+			glb.inCnt = (in == 0) ? IN_HEADER : IN_REG;
+			break;
+		case IN_REG: // next value is the register
+			glb.YM_reg = in;
+			glb.inCnt = IN_DATA;
+			break;
+		case IN_DATA: // then the data to write
+			glb.YM_data = in;
+			
+			// queue the write for the main loop, writeFlag is which channels will be written to
+			if((uint8_t)(glb.fifoHead - glb.fifoTail) < FIFO_SIZE){
+				volatile struct Frame* frame = &glb.fifo[glb.fifoHead & FIFO_MASK];
+				
+				frame->flag = glb.writeFlag;
+				frame->reg = glb.YM_reg;
+				frame->data = glb.YM_data;
+				++glb.fifoHead;
+			} else {
+				++glb.fifoDropped;
+			}
+			
+			// every pair is done, the next value is a new header
+			glb.inCnt = (--glb.burstLeft == 0) ? IN_HEADER : IN_REG;
 			break;
-		case 1: // next value is the register
-			glb.YM_reg = SPDR;
+		case IN_DAC_NUM: // sample to play, doesn't go through the FIFO so it isn't held up behind FM writes
+			glb.dacReqNum = in;
+			glb.inCnt = IN_DAC_VEL;
 			break;
-		case 2: // last is the data to write
-			glb.YM_data = SPDR;
-			setreg(glb.YM_reg,glb.YM_data,glb.writeFlag); // write everything, writeFlag is which channels will be written to
+		case IN_DAC_VEL:
+			glb.dacReqVel = in;
+			glb.dacReq = true;
+			glb.inCnt = IN_HEADER;
 			break;
 	}
-	
-	++glb.inCnt; // next value sent over SPI has a different purpose
-	
-	if(glb.inCnt > 2) glb.inCnt = 0; // every 3rd value sent is the end of a complete transmission
-	
-	SPDR = 0; //glb.inCnt + (glb.writeFlag<<4); for testing
-	SREG = glb.sreg;
-};
\ No newline at end of file
+}
@@ -0,0 +1,253 @@
+/*
+ * samples.h
+ * drum samples for the YM2612's DAC (channel 6), played by the slave when the main controller sends FRAME_DAC
+ *
+ * 8 bit unsigned (0x80 is silence) at DAC_RATE (8 kHz), made up rather than recorded:
+ *  - kick: a sine swept from 160 Hz down to 50 Hz
+ *  - snare: noise and a 190 Hz sine
+ *  - hat: high passed noise
+ * each one fades out over its last fifth, so it always ends on silence
+ *
+ * adding one is adding an array here and a line in samples[] (the main controller's drumMap[] says which notes play it)
+ */
+
+#ifndef SAMPLES_H_
+#define SAMPLES_H_
+
+// kick: 1600 samples, 200 ms
+const uint8_t sampleKick[] PROGMEM = {
+	0x8F, 0x9E, 0xAC, 0xBA, 0xC6, 0xD2, 0xDC, 0xE4, 0xEC, 0xF1, 0xF5, 0xF7, 0xF7, 0xF6, 0xF2, 0xEE,
+	0xE7, 0xDF, 0xD6, 0xCC, 0xC0, 0xB4, 0xA7, 0x9A, 0x8C, 0x7F, 0x71, 0x63, 0x56, 0x4A, 0x3F, 0x34,
+	0x2A, 0x22, 0x1B, 0x15, 0x11, 0x0E, 0x0C, 0x0C, 0x0E, 0x11, 0x15, 0x1B, 0x21, 0x29, 0x32, 0x3C,
+	0x47, 0x52, 0x5E, 0x6A, 0x76, 0x83, 0x8F, 0x9B, 0xA7, 0xB2, 0xBD, 0xC6, 0xCF, 0xD7, 0xDE, 0xE4,
+	0xE9, 0xED, 0xEF, 0xF0, 0xF0, 0xEF, 0xED, 0xE9, 0xE4, 0xDE, 0xD8, 0xD0, 0xC8, 0xBF, 0xB5, 0xAB,
+	0xA0, 0x95, 0x8A, 0x7F, 0x74, 0x69, 0x5E, 0x54, 0x4A, 0x41, 0x39, 0x31, 0x2A, 0x24, 0x1F, 0x1A,
+	0x17, 0x15, 0x13, 0x13, 0x14, 0x16, 0x18, 0x1C, 0x20, 0x26, 0x2C, 0x33, 0x3A, 0x43, 0x4B, 0x54,
+	0x5E, 0x67, 0x71, 0x7B, 0x85, 0x8F, 0x98, 0xA2, 0xAB, 0xB3, 0xBC, 0xC3, 0xCA, 0xD1, 0xD7, 0xDC,
+	0xE0, 0xE3, 0xE6, 0xE8, 0xE9, 0xE9, 0xE8, 0xE7, 0xE5, 0xE2, 0xDE, 0xD9, 0xD4, 0xCE, 0xC8, 0xC1,
+	0xBA, 0xB2, 0xAA, 0xA2, 0x99, 0x91, 0x88, 0x7F, 0x76, 0x6E, 0x65, 0x5D, 0x55, 0x4D, 0x46, 0x3F,
+	0x39, 0x33, 0x2E, 0x29, 0x25, 0x22, 0x1F, 0x1D, 0x1C, 0x1B, 0x1B, 0x1C, 0x1D, 0x1F, 0x21, 0x25,
+	0x28, 0x2D, 0x32, 0x37, 0x3D, 0x43, 0x49, 0x50, 0x57, 0x5F, 0x66, 0x6E, 0x76, 0x7E, 0x85, 0x8D,
+	0x95, 0x9C, 0xA3, 0xAA, 0xB1, 0xB7, 0xBD, 0xC3, 0xC8, 0xCD, 0xD1, 0xD5, 0xD8, 0xDB, 0xDD, 0xDF,
+	0xE0, 0xE1, 0xE1, 0xE0, 0xDF, 0xDE, 0xDC, 0xD9, 0xD6, 0xD3, 0xCF, 0xCA, 0xC5, 0xC0, 0xBB, 0xB5,
+	0xAF, 0xA9, 0xA2, 0x9C, 0x95, 0x8E, 0x87, 0x81, 0x7A, 0x73, 0x6C, 0x66, 0x5F, 0x59, 0x53, 0x4D,
+	0x48, 0x43, 0x3E, 0x3A, 0x35, 0x32, 0x2E, 0x2C, 0x29, 0x27, 0x25, 0x24, 0x24, 0x23, 0x24, 0x24,
+	0x25, 0x27, 0x29, 0x2B, 0x2E, 0x31, 0x34, 0x38, 0x3C, 0x40, 0x45, 0x4A, 0x4F, 0x54, 0x5A, 0x60,
+	0x65, 0x6B, 0x71, 0x77, 0x7D, 0x83, 0x89, 0x8F, 0x95, 0x9B, 0xA0, 0xA6, 0xAB, 0xB0, 0xB5, 0xB9,
+	0xBE, 0xC2, 0xC5, 0xC9, 0xCC, 0xCF, 0xD1, 0xD3, 0xD5, 0xD6, 0xD7, 0xD8, 0xD8, 0xD8, 0xD8, 0xD7,
+	0xD6, 0xD4, 0xD2, 0xD0, 0xCE, 0xCB, 0xC8, 0xC5, 0xC1, 0xBD, 0xB9, 0xB5, 0xB1, 0xAC, 0xA7, 0xA2,
+	0x9D, 0x98, 0x93, 0x8E, 0x88, 0x83, 0x7E, 0x79, 0x73, 0x6E, 0x69, 0x64, 0x5F, 0x5B, 0x56, 0x52,
+	0x4E, 0x4A, 0x46, 0x42, 0x3F, 0x3C, 0x39, 0x37, 0x34, 0x32, 0x31, 0x2F, 0x2E, 0x2D, 0x2D, 0x2C,
+	0x2C, 0x2D, 0x2D, 0x2E, 0x2F, 0x31, 0x33, 0x35, 0x37, 0x39, 0x3C, 0x3F, 0x42, 0x46, 0x49, 0x4D,
+	0x51, 0x55, 0x59, 0x5D, 0x61, 0x66, 0x6A, 0x6F, 0x74, 0x78, 0x7D, 0x82, 0x86, 0x8B, 0x8F, 0x94,
+	0x98, 0x9C, 0xA1, 0xA5, 0xA9, 0xAC, 0xB0, 0xB4, 0xB7, 0xBA, 0xBD, 0xC0, 0xC2, 0xC5, 0xC7, 0xC9,
+	0xCA, 0xCC, 0xCD, 0xCE, 0xCE, 0xCF, 0xCF, 0xCF, 0xCF, 0xCE, 0xCD, 0xCC, 0xCB, 0xCA, 0xC8, 0xC6,
+	0xC4, 0xC2, 0xC0, 0xBD, 0xBA, 0xB7, 0xB4, 0xB1, 0xAD, 0xAA, 0xA6, 0xA3, 0x9F, 0x9B, 0x97, 0x93,
+	0x8F, 0x8B, 0x87, 0x83, 0x7F, 0x7B, 0x77, 0x73, 0x6F, 0x6B, 0x67, 0x63, 0x60, 0x5C, 0x59, 0x55,
+	0x52, 0x4F, 0x4C, 0x49, 0x47, 0x44, 0x42, 0x40, 0x3E, 0x3C, 0x3B, 0x3A, 0x38, 0x37, 0x37, 0x36,
+	0x36, 0x36, 0x36, 0x36, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3C, 0x3D, 0x3F, 0x41, 0x43, 0x45, 0x47,
+	0x4A, 0x4C, 0x4F, 0x52, 0x55, 0x58, 0x5B, 0x5F, 0x62, 0x65, 0x69, 0x6C, 0x70, 0x73, 0x77, 0x7B,
+	0x7E, 0x82, 0x85, 0x89, 0x8D, 0x90, 0x94, 0x97, 0x9A, 0x9D, 0xA1, 0xA4, 0xA7, 0xAA, 0xAC, 0xAF,
+	0xB1, 0xB4, 0xB6, 0xB8, 0xBA, 0xBC, 0xBE, 0xBF, 0xC1, 0xC2, 0xC3, 0xC4, 0xC4, 0xC5, 0xC5, 0xC6,
+	0xC6, 0xC5, 0xC5, 0xC5, 0xC4, 0xC3, 0xC2, 0xC1, 0xC0, 0xBF, 0xBD, 0xBC, 0xBA, 0xB8, 0xB6, 0xB4,
+	0xB1, 0xAF, 0xAC, 0xAA, 0xA7, 0xA4, 0xA2, 0x9F, 0x9C, 0x99, 0x96, 0x93, 0x8F, 0x8C, 0x89, 0x86,
+	0x83, 0x7F, 0x7C, 0x79, 0x76, 0x73, 0x70, 0x6D, 0x6A, 0x67, 0x64, 0x61, 0x5E, 0x5C, 0x59, 0x57,
+	0x54, 0x52, 0x50, 0x4E, 0x4C, 0x4A, 0x49, 0x47, 0x46, 0x44, 0x43, 0x42, 0x41, 0x41, 0x40, 0x40,
+	0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x40, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x48, 0x49, 0x4B,
+	0x4D, 0x4E, 0x50, 0x52, 0x55, 0x57, 0x59, 0x5C, 0x5E, 0x61, 0x63, 0x66, 0x69, 0x6B, 0x6E, 0x71,
+	0x74, 0x76, 0x79, 0x7C, 0x7F, 0x82, 0x85, 0x88, 0x8A, 0x8D, 0x90, 0x93, 0x95, 0x98, 0x9A, 0x9D,
+	0x9F, 0xA2, 0xA4, 0xA6, 0xA8, 0xAA, 0xAC, 0xAE, 0xB0, 0xB1, 0xB3, 0xB4, 0xB6, 0xB7, 0xB8, 0xB9,
+	0xBA, 0xBB, 0xBB, 0xBC, 0xBC, 0xBC, 0xBC, 0xBC, 0xBC, 0xBC, 0xBC, 0xBB, 0xBB, 0xBA, 0xB9, 0xB8,
+	0xB7, 0xB6, 0xB5, 0xB4, 0xB2, 0xB1, 0xAF, 0xAD, 0xAB, 0xAA, 0xA8, 0xA6, 0xA3, 0xA1, 0x9F, 0x9D,
+	0x9A, 0x98, 0x96, 0x93, 0x91, 0x8E, 0x8C, 0x89, 0x87, 0x84, 0x81, 0x7F, 0x7C, 0x7A, 0x77, 0x75,
+	0x72, 0x70, 0x6E, 0x6B, 0x69, 0x67, 0x64, 0x62, 0x60, 0x5E, 0x5C, 0x5A, 0x58, 0x57, 0x55, 0x54,
+	0x52, 0x51, 0x4F, 0x4E, 0x4D, 0x4C, 0x4B, 0x4A, 0x4A, 0x49, 0x49, 0x48, 0x48, 0x48, 0x48, 0x48,
+	0x48, 0x48, 0x49, 0x49, 0x4A, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F, 0x50, 0x52, 0x53, 0x55, 0x56,
+	0x58, 0x59, 0x5B, 0x5D, 0x5F, 0x61, 0x63, 0x65, 0x67, 0x69, 0x6B, 0x6D, 0x70, 0x72, 0x74, 0x77,
+	0x79, 0x7B, 0x7D, 0x80, 0x82, 0x84, 0x87, 0x89, 0x8B, 0x8D, 0x90, 0x92, 0x94, 0x96, 0x98, 0x9A,
+	0x9C, 0x9E, 0xA0, 0xA1, 0xA3, 0xA5, 0xA6, 0xA8, 0xA9, 0xAA, 0xAC, 0xAD, 0xAE, 0xAF, 0xB0, 0xB1,
+	0xB1, 0xB2, 0xB3, 0xB3, 0xB3, 0xB4, 0xB4, 0xB4, 0xB4, 0xB4, 0xB4, 0xB3, 0xB3, 0xB3, 0xB2, 0xB1,
+	0xB1, 0xB0, 0xAF, 0xAE, 0xAD, 0xAC, 0xAB, 0xA9, 0xA8, 0xA7, 0xA5, 0xA4, 0xA2, 0xA0, 0x9F, 0x9D,
+	0x9B, 0x99, 0x97, 0x95, 0x93, 0x91, 0x8F, 0x8D, 0x8B, 0x89, 0x87, 0x85, 0x83, 0x81, 0x7F, 0x7D,
+	0x7B, 0x79, 0x77, 0x75, 0x73, 0x71, 0x6F, 0x6D, 0x6B, 0x69, 0x67, 0x66, 0x64, 0x62, 0x61, 0x5F,
+	0x5E, 0x5C, 0x5B, 0x5A, 0x59, 0x57, 0x56, 0x55, 0x55, 0x54, 0x53, 0x52, 0x52, 0x51, 0x51, 0x50,
+	0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x51, 0x51, 0x52, 0x52, 0x53, 0x53, 0x54, 0x55, 0x56,
+	0x57, 0x58, 0x59, 0x5A, 0x5C, 0x5D, 0x5E, 0x60, 0x61, 0x63, 0x64, 0x66, 0x68, 0x69, 0x6B, 0x6D,
+	0x6F, 0x70, 0x72, 0x74, 0x76, 0x78, 0x7A, 0x7C, 0x7E, 0x80, 0x81, 0x83, 0x85, 0x87, 0x89, 0x8B,
+	0x8D, 0x8E, 0x90, 0x92, 0x94, 0x95, 0x97, 0x98, 0x9A, 0x9B, 0x9D, 0x9E, 0xA0, 0xA1, 0xA2, 0xA3,
+	0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xA9, 0xAA, 0xAB, 0xAB, 0xAC, 0xAC, 0xAC, 0xAC, 0xAC, 0xAC,
+	0xAC, 0xAC, 0xAC, 0xAC, 0xAB, 0xAB, 0xAB, 0xAA, 0xA9, 0xA9, 0xA8, 0xA7, 0xA6, 0xA5, 0xA4, 0xA3,
+	0xA2, 0xA1, 0xA0, 0x9F, 0x9D, 0x9C, 0x9A, 0x99, 0x98, 0x96, 0x94, 0x93, 0x91, 0x90, 0x8E, 0x8C,
+	0x8B, 0x89, 0x87, 0x85, 0x84, 0x82, 0x80, 0x7E, 0x7D, 0x7B, 0x79, 0x78, 0x76, 0x74, 0x73, 0x71,
+	0x70, 0x6E, 0x6C, 0x6B, 0x6A, 0x68, 0x67, 0x66, 0x64, 0x63, 0x62, 0x61, 0x60, 0x5F, 0x5E, 0x5D,
+	0x5C, 0x5B, 0x5B, 0x5A, 0x59, 0x59, 0x58, 0x58, 0x58, 0x57, 0x57, 0x57, 0x57, 0x57, 0x57, 0x57,
+	0x57, 0x58, 0x58, 0x59, 0x59, 0x5A, 0x5A, 0x5B, 0x5C, 0x5C, 0x5D, 0x5E, 0x5F, 0x60, 0x61, 0x62,
+	0x63, 0x64, 0x66, 0x67, 0x68, 0x69, 0x6B, 0x6C, 0x6E, 0x6F, 0x71, 0x72, 0x74, 0x75, 0x77, 0x78,
+	0x7A, 0x7B, 0x7D, 0x7F, 0x80, 0x82, 0x83, 0x85, 0x87, 0x88, 0x8A, 0x8B, 0x8D, 0x8E, 0x8F, 0x91,
+	0x92, 0x94, 0x95, 0x96, 0x97, 0x99, 0x9A, 0x9B, 0x9C, 0x9D, 0x9E, 0x9F, 0xA0, 0xA0, 0xA1, 0xA2,
+	0xA3, 0xA3, 0xA4, 0xA4, 0xA5, 0xA5, 0xA5, 0xA5, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA5, 0xA5,
+	0xA5, 0xA4, 0xA4, 0xA4, 0xA3, 0xA2, 0xA2, 0xA1, 0xA0, 0x9F, 0x9F, 0x9E, 0x9D, 0x9C, 0x9B, 0x9A,
+	0x99, 0x97, 0x96, 0x95, 0x94, 0x93, 0x91, 0x90, 0x8F, 0x8D, 0x8C, 0x8A, 0x89, 0x88, 0x86, 0x85,
+	0x83, 0x82, 0x80, 0x7F, 0x7D, 0x7C, 0x7B, 0x79, 0x78, 0x76, 0x75, 0x74, 0x72, 0x71, 0x70, 0x6E,
+	0x6D, 0x6C, 0x6B, 0x6A, 0x69, 0x68, 0x67, 0x66, 0x65, 0x64, 0x63, 0x62, 0x62, 0x61, 0x60, 0x60,
+	0x5F, 0x5F, 0x5F, 0x5E, 0x5E, 0x5E, 0x5D, 0x5D, 0x5D, 0x5D, 0x5D, 0x5D, 0x5D, 0x5E, 0x5E, 0x5E,
+	0x5F, 0x5F, 0x5F, 0x60, 0x61, 0x61, 0x62, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A,
+	0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70, 0x72, 0x73, 0x74, 0x75, 0x77, 0x78, 0x79, 0x7B, 0x7C, 0x7D,
+	0x7F, 0x80, 0x81, 0x83, 0x84, 0x85, 0x87, 0x88, 0x89, 0x8A, 0x8C, 0x8D, 0x8E, 0x8F, 0x90, 0x91,
+	0x92, 0x94, 0x95, 0x96, 0x96, 0x97, 0x98, 0x99, 0x9A, 0x9B, 0x9B, 0x9C, 0x9D, 0x9D, 0x9E, 0x9E,
+	0x9F, 0x9F, 0x9F, 0x9F, 0xA0, 0xA0, 0xA0, 0xA0, 0xA0, 0xA0, 0xA0, 0xA0, 0xA0, 0x9F, 0x9F, 0x9F,
+	0x9E, 0x9E, 0x9E, 0x9D, 0x9C, 0x9B, 0x9A, 0x9A, 0x99, 0x98, 0x97, 0x96, 0x95, 0x95, 0x94, 0x93,
+	0x92, 0x91, 0x90, 0x8F, 0x8D, 0x8C, 0x8B, 0x8A, 0x89, 0x88, 0x86, 0x85, 0x85, 0x84, 0x83, 0x81,
+	0x80, 0x7F, 0x7E, 0x7D, 0x7C, 0x7B, 0x7A, 0x79, 0x78, 0x77, 0x76, 0x75, 0x74, 0x73, 0x72, 0x72,
+	0x71, 0x70, 0x6F, 0x6E, 0x6E, 0x6E, 0x6D, 0x6C, 0x6C, 0x6C, 0x6B, 0x6B, 0x6A, 0x6A, 0x6A, 0x6A,
+	0x6A, 0x69, 0x69, 0x69, 0x69, 0x69, 0x69, 0x69, 0x69, 0x6A, 0x6A, 0x6A, 0x6A, 0x6A, 0x6B, 0x6B,
+	0x6B, 0x6C, 0x6C, 0x6D, 0x6D, 0x6E, 0x6E, 0x6F, 0x6F, 0x6F, 0x70, 0x71, 0x72, 0x73, 0x73, 0x74,
+	0x74, 0x75, 0x76, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x7B, 0x7B, 0x7C, 0x7D, 0x7D, 0x7E, 0x7F, 0x7F,
+	0x81, 0x81, 0x82, 0x83, 0x83, 0x84, 0x84, 0x85, 0x86, 0x86, 0x87, 0x87, 0x88, 0x88, 0x89, 0x8A,
+	0x8A, 0x8B, 0x8B, 0x8B, 0x8C, 0x8C, 0x8C, 0x8D, 0x8D, 0x8D, 0x8E, 0x8E, 0x8E, 0x8E, 0x8E, 0x8E,
+	0x8E, 0x8F, 0x8F, 0x8F, 0x8E, 0x8E, 0x8E, 0x8E, 0x8E, 0x8E, 0x8E, 0x8E, 0x8E, 0x8D, 0x8D, 0x8D,
+	0x8C, 0x8C, 0x8C, 0x8C, 0x8B, 0x8B, 0x8B, 0x8A, 0x8A, 0x89, 0x89, 0x89, 0x88, 0x88, 0x88, 0x87,
+	0x87, 0x86, 0x86, 0x85, 0x85, 0x84, 0x84, 0x83, 0x83, 0x83, 0x82, 0x82, 0x81, 0x81, 0x80, 0x80,
+	0x80, 0x7F, 0x7F, 0x7E, 0x7E, 0x7E, 0x7D, 0x7D, 0x7D, 0x7C, 0x7C, 0x7C, 0x7B, 0x7B, 0x7B, 0x7B,
+	0x7A, 0x7A, 0x7A, 0x7A, 0x7A, 0x7A, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79,
+	0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x7A, 0x7A, 0x7A, 0x7A,
+	0x7A, 0x7A, 0x7B, 0x7B, 0x7B, 0x7B, 0x7B, 0x7C, 0x7C, 0x7C, 0x7C, 0x7C, 0x7D, 0x7D, 0x7D, 0x7D,
+	0x7D, 0x7D, 0x7E, 0x7E, 0x7E, 0x7E, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81,
+	0x81, 0x82, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81,
+	0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+// snare: 1280 samples, 160 ms
+const uint8_t sampleSnare[] PROGMEM = {
+	0x7E, 0x64, 0xA7, 0xCB, 0x93, 0xC5, 0x94, 0xC8, 0x98, 0xCA, 0x98, 0x7E, 0x6F, 0xB0, 0x84, 0x6B,
+	0xA5, 0xBE, 0xC8, 0x80, 0x58, 0x41, 0x7B, 0x4C, 0x7A, 0x8F, 0x97, 0x53, 0x77, 0x88, 0x4A, 0x2B,
+	0x1D, 0x18, 0x5D, 0x3C, 0x2E, 0x2A, 0x71, 0x98, 0xAE, 0x78, 0xA4, 0xBD, 0xCD, 0x93, 0x77, 0xB0,
+	0xCD, 0xDD, 0xA1, 0x84, 0x75, 0xAF, 0xCB, 0xD7, 0xDB, 0x98, 0xB6, 0x81, 0xA5, 0x72, 0x56, 0x45,
+	0x3A, 0x32, 0x2B, 0x67, 0x43, 0x2F, 0x25, 0x60, 0x3D, 0x6C, 0x44, 0x32, 0x6A, 0x48, 0x79, 0x54,
+	0x84, 0x9E, 0xAD, 0xB8, 0x82, 0xA7, 0xBC, 0xC9, 0x93, 0xB7, 0xCA, 0x98, 0xBC, 0x91, 0x7B, 0x70,
+	0x69, 0xA1, 0xBA, 0xC5, 0xC8, 0xC8, 0x89, 0x68, 0x90, 0x66, 0x4F, 0x41, 0x39, 0x6D, 0x4C, 0x74,
+	0x87, 0x90, 0x95, 0x97, 0x99, 0x62, 0x81, 0x59, 0x46, 0x3F, 0x3E, 0x40, 0x43, 0x47, 0x83, 0x6C,
+	0x9A, 0x7B, 0x6D, 0x68, 0x66, 0x66, 0x9D, 0x82, 0x74, 0xA3, 0x84, 0x73, 0x9F, 0xB3, 0x86, 0x6D,
+	0x94, 0xA5, 0x77, 0x93, 0x69, 0x53, 0x47, 0x3F, 0x6E, 0x50, 0x41, 0x39, 0x35, 0x34, 0x67, 0x81,
+	0x5C, 0x4B, 0x44, 0x42, 0x43, 0x78, 0x94, 0x72, 0x95, 0xA9, 0xB4, 0xBB, 0x8E, 0xAA, 0xB9, 0xC1,
+	0xC5, 0xC7, 0xC8, 0xC8, 0x97, 0xAE, 0x87, 0x73, 0x67, 0x90, 0xA3, 0x7A, 0x94, 0x6F, 0x5C, 0x80,
+	0x61, 0x50, 0x47, 0x42, 0x6D, 0x54, 0x76, 0x87, 0x90, 0x67, 0x81, 0x62, 0x53, 0x7B, 0x62, 0x58,
+	0x54, 0x54, 0x56, 0x58, 0x88, 0xA1, 0x82, 0x73, 0x9A, 0x81, 0x75, 0x9B, 0x82, 0xA1, 0x84, 0xA0,
+	0xAD, 0xB3, 0x89, 0x72, 0x91, 0x74, 0x64, 0x5A, 0x7F, 0x90, 0x6D, 0x85, 0x65, 0x7F, 0x61, 0x7C,
+	0x8A, 0x66, 0x7F, 0x8C, 0x69, 0x82, 0x90, 0x98, 0x9D, 0x78, 0x66, 0x88, 0x9A, 0x7C, 0x6E, 0x68,
+	0x66, 0x66, 0x8F, 0x7C, 0x73, 0x96, 0xA8, 0x88, 0x78, 0x70, 0x92, 0xA2, 0xA9, 0xAB, 0x84, 0x96,
+	0x78, 0x8E, 0x71, 0x61, 0x7F, 0x66, 0x5A, 0x53, 0x75, 0x5F, 0x55, 0x50, 0x73, 0x60, 0x7C, 0x8B,
+	0x6E, 0x60, 0x80, 0x90, 0x9A, 0xA0, 0xA3, 0xA6, 0xA9, 0x87, 0x76, 0x93, 0xA2, 0x86, 0x78, 0x95,
+	0xA4, 0xAB, 0x8A, 0x79, 0x94, 0xA0, 0xA6, 0x84, 0x72, 0x68, 0x63, 0x5F, 0x7F, 0x6B, 0x60, 0x7D,
+	0x68, 0x7F, 0x68, 0x5D, 0x57, 0x76, 0x85, 0x8D, 0x70, 0x84, 0x6D, 0x62, 0x7F, 0x8E, 0x97, 0x7B,
+	0x8F, 0x79, 0x6F, 0x6B, 0x8A, 0x7A, 0x72, 0x8F, 0x9E, 0xA5, 0x89, 0x9A, 0x83, 0x77, 0x70, 0x8C,
+	0x99, 0x9F, 0x81, 0x91, 0x98, 0x7C, 0x8C, 0x74, 0x67, 0x60, 0x7B, 0x69, 0x60, 0x5B, 0x77, 0x85,
+	0x6E, 0x63, 0x7C, 0x6B, 0x63, 0x7D, 0x8B, 0x93, 0x98, 0x9B, 0x7F, 0x90, 0x7C, 0x72, 0x8B, 0x7B,
+	0x73, 0x8D, 0x9A, 0xA1, 0xA4, 0xA5, 0x89, 0x7B, 0x73, 0x8B, 0x7A, 0x71, 0x6C, 0x85, 0x91, 0x96,
+	0x98, 0x98, 0x97, 0x7A, 0x6C, 0x80, 0x89, 0x8E, 0x90, 0x75, 0x68, 0x7E, 0x88, 0x73, 0x84, 0x8D,
+	0x92, 0x7A, 0x8A, 0x92, 0x7C, 0x8D, 0x96, 0x80, 0x76, 0x8B, 0x7C, 0x8F, 0x99, 0x9E, 0xA0, 0x87,
+	0x7B, 0x74, 0x71, 0x88, 0x7A, 0x8B, 0x94, 0x7E, 0x72, 0x6C, 0x68, 0x7F, 0x71, 0x82, 0x71, 0x69,
+	0x64, 0x62, 0x7A, 0x85, 0x8B, 0x8E, 0x77, 0x6C, 0x67, 0x7E, 0x89, 0x77, 0x6F, 0x6B, 0x82, 0x76,
+	0x89, 0x7A, 0x8C, 0x7D, 0x76, 0x72, 0x89, 0x7C, 0x8D, 0x7F, 0x8E, 0x7F, 0x8E, 0x7E, 0x75, 0x88,
+	0x7A, 0x89, 0x90, 0x7C, 0x89, 0x78, 0x6F, 0x6A, 0x67, 0x7C, 0x86, 0x75, 0x82, 0x73, 0x81, 0x72,
+	0x81, 0x73, 0x6C, 0x69, 0x68, 0x7E, 0x89, 0x8F, 0x93, 0x95, 0x81, 0x77, 0x73, 0x87, 0x7B, 0x76,
+	0x73, 0x87, 0x7C, 0x8C, 0x93, 0x97, 0x98, 0x84, 0x79, 0x88, 0x90, 0x93, 0x94, 0x94, 0x7F, 0x74,
+	0x6E, 0x6B, 0x69, 0x7C, 0x86, 0x76, 0x82, 0x88, 0x8C, 0x8D, 0x8E, 0x7B, 0x85, 0x8B, 0x8E, 0x90,
+	0x91, 0x92, 0x7F, 0x8A, 0x7C, 0x89, 0x90, 0x80, 0x8C, 0x92, 0x82, 0x8D, 0x80, 0x8C, 0x7F, 0x78,
+	0x88, 0x8F, 0x92, 0x81, 0x78, 0x73, 0x71, 0x81, 0x89, 0x7A, 0x85, 0x8A, 0x8D, 0x8D, 0x7B, 0x72,
+	0x6E, 0x7E, 0x73, 0x80, 0x87, 0x8B, 0x7B, 0x85, 0x78, 0x73, 0x82, 0x78, 0x73, 0x83, 0x7A, 0x75,
+	0x73, 0x84, 0x8C, 0x80, 0x79, 0x87, 0x7D, 0x78, 0x76, 0x74, 0x73, 0x84, 0x8C, 0x7E, 0x88, 0x7C,
+	0x76, 0x83, 0x79, 0x84, 0x79, 0x83, 0x88, 0x8B, 0x8C, 0x8C, 0x8C, 0x7C, 0x84, 0x78, 0x82, 0x88,
+	0x7A, 0x84, 0x79, 0x74, 0x81, 0x79, 0x84, 0x7B, 0x76, 0x84, 0x8B, 0x8F, 0x81, 0x8A, 0x7F, 0x89,
+	0x7F, 0x89, 0x8E, 0x90, 0x91, 0x91, 0x91, 0x82, 0x89, 0x7D, 0x86, 0x7C, 0x76, 0x82, 0x79, 0x74,
+	0x80, 0x77, 0x82, 0x78, 0x73, 0x7F, 0x77, 0x81, 0x86, 0x7B, 0x75, 0x72, 0x71, 0x7F, 0x86, 0x8A,
+	0x8C, 0x7F, 0x87, 0x7D, 0x87, 0x8B, 0x8E, 0x8F, 0x82, 0x8A, 0x7F, 0x88, 0x7F, 0x7A, 0x77, 0x84,
+	0x8A, 0x7F, 0x79, 0x76, 0x74, 0x73, 0x80, 0x79, 0x82, 0x7A, 0x83, 0x7A, 0x82, 0x79, 0x82, 0x86,
+	0x88, 0x89, 0x7D, 0x77, 0x81, 0x79, 0x75, 0x74, 0x73, 0x73, 0x80, 0x7A, 0x77, 0x76, 0x82, 0x88,
+	0x8C, 0x81, 0x88, 0x7F, 0x87, 0x8B, 0x80, 0x88, 0x8B, 0x8D, 0x81, 0x7B, 0x78, 0x82, 0x7B, 0x84,
+	0x88, 0x89, 0x7E, 0x78, 0x81, 0x86, 0x7C, 0x77, 0x74, 0x7F, 0x78, 0x75, 0x74, 0x7F, 0x79, 0x81,
+	0x7A, 0x77, 0x75, 0x80, 0x7A, 0x83, 0x88, 0x8A, 0x8B, 0x8C, 0x81, 0x87, 0x8A, 0x81, 0x87, 0x8A,
+	0x80, 0x7C, 0x79, 0x78, 0x82, 0x87, 0x7E, 0x85, 0x7D, 0x79, 0x77, 0x76, 0x80, 0x85, 0x87, 0x7D,
+	0x83, 0x86, 0x87, 0x88, 0x7E, 0x79, 0x76, 0x75, 0x7F, 0x7A, 0x77, 0x80, 0x85, 0x88, 0x7F, 0x7A,
+	0x83, 0x7D, 0x84, 0x7D, 0x7A, 0x83, 0x7D, 0x85, 0x88, 0x80, 0x7C, 0x84, 0x88, 0x8A, 0x8A, 0x8B,
+	0x8B, 0x81, 0x85, 0x7E, 0x84, 0x86, 0x7E, 0x7A, 0x81, 0x85, 0x87, 0x7E, 0x83, 0x7C, 0x78, 0x80,
+	0x84, 0x86, 0x87, 0x7E, 0x7A, 0x81, 0x7C, 0x82, 0x7C, 0x7A, 0x82, 0x86, 0x88, 0x89, 0x81, 0x85,
+	0x88, 0x89, 0x8A, 0x8A, 0x8A, 0x8A, 0x8A, 0x8A, 0x8A, 0x81, 0x7C, 0x83, 0x86, 0x7F, 0x84, 0x7D,
+	0x7A, 0x78, 0x77, 0x77, 0x7F, 0x83, 0x85, 0x7E, 0x7A, 0x81, 0x84, 0x7D, 0x7A, 0x78, 0x80, 0x84,
+	0x86, 0x7F, 0x7B, 0x79, 0x81, 0x7D, 0x7A, 0x79, 0x81, 0x7D, 0x7B, 0x7A, 0x7A, 0x79, 0x79, 0x79,
+	0x81, 0x85, 0x87, 0x88, 0x88, 0x88, 0x88, 0x80, 0x84, 0x7E, 0x7B, 0x81, 0x84, 0x7E, 0x82, 0x85,
+	0x7E, 0x7A, 0x81, 0x7C, 0x79, 0x78, 0x80, 0x83, 0x7D, 0x82, 0x7D, 0x7B, 0x81, 0x7D, 0x82, 0x7E,
+	0x83, 0x86, 0x7F, 0x84, 0x86, 0x87, 0x80, 0x84, 0x7F, 0x84, 0x86, 0x80, 0x84, 0x86, 0x80, 0x7C,
+	0x82, 0x85, 0x86, 0x7F, 0x83, 0x85, 0x86, 0x7F, 0x7B, 0x7A, 0x80, 0x7C, 0x7A, 0x80, 0x7C, 0x81,
+	0x84, 0x85, 0x86, 0x7F, 0x7C, 0x7A, 0x81, 0x84, 0x7F, 0x7C, 0x82, 0x7E, 0x7C, 0x7B, 0x7B, 0x81,
+	0x7E, 0x7C, 0x7B, 0x81, 0x7E, 0x7C, 0x82, 0x7E, 0x82, 0x7E, 0x7C, 0x7B, 0x81, 0x83, 0x85, 0x85,
+	0x86, 0x7F, 0x7C, 0x81, 0x83, 0x84, 0x7F, 0x82, 0x7D, 0x7B, 0x80, 0x83, 0x84, 0x85, 0x85, 0x80,
+	0x83, 0x7E, 0x82, 0x7E, 0x7C, 0x81, 0x84, 0x85, 0x86, 0x86, 0x87, 0x81, 0x7E, 0x82, 0x7E, 0x82,
+	0x84, 0x85, 0x86, 0x86, 0x86, 0x80, 0x83, 0x84, 0x85, 0x85, 0x85, 0x7F, 0x7D, 0x7B, 0x80, 0x7D,
+	0x81, 0x7D, 0x81, 0x83, 0x7E, 0x82, 0x83, 0x84, 0x7F, 0x7D, 0x81, 0x7E, 0x82, 0x7E, 0x82, 0x84,
+	0x7F, 0x7D, 0x82, 0x83, 0x80, 0x83, 0x83, 0x84, 0x85, 0x80, 0x82, 0x83, 0x84, 0x80, 0x7E, 0x7D,
+	0x81, 0x7E, 0x81, 0x7E, 0x7D, 0x7C, 0x80, 0x82, 0x82, 0x7F, 0x7E, 0x7C, 0x80, 0x7E, 0x81, 0x82,
+	0x7F, 0x81, 0x7F, 0x7E, 0x7D, 0x7C, 0x7C, 0x7C, 0x80, 0x7F, 0x7E, 0x81, 0x7F, 0x81, 0x7F, 0x7E,
+	0x7D, 0x81, 0x7F, 0x81, 0x7F, 0x81, 0x7F, 0x7E, 0x81, 0x82, 0x83, 0x7F, 0x81, 0x82, 0x7F, 0x81,
+	0x7F, 0x7E, 0x80, 0x81, 0x82, 0x82, 0x7F, 0x81, 0x82, 0x7F, 0x7E, 0x81, 0x7F, 0x81, 0x82, 0x82,
+	0x82, 0x80, 0x7F, 0x81, 0x7F, 0x81, 0x7F, 0x81, 0x82, 0x80, 0x7F, 0x7E, 0x7E, 0x81, 0x82, 0x82,
+	0x82, 0x82, 0x80, 0x81, 0x81, 0x82, 0x82, 0x82, 0x80, 0x81, 0x80, 0x80, 0x81, 0x81, 0x80, 0x80,
+	0x81, 0x80, 0x80, 0x81, 0x80, 0x7F, 0x80, 0x81, 0x80, 0x81, 0x81, 0x81, 0x80, 0x7F, 0x7F, 0x7F,
+	0x80, 0x7F, 0x7F, 0x7F, 0x80, 0x80, 0x80, 0x81, 0x80, 0x7F, 0x80, 0x80, 0x7F, 0x80, 0x81, 0x81,
+	0x81, 0x80, 0x7F, 0x80, 0x81, 0x80, 0x80, 0x80, 0x7F, 0x80, 0x81, 0x81, 0x80, 0x80, 0x81, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x81, 0x81, 0x80, 0x80, 0x81, 0x80, 0x80, 0x80, 0x80, 0x7F, 0x80,
+	0x80, 0x80, 0x80, 0x81, 0x81, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+// closed hat: 480 samples, 60 ms
+const uint8_t sampleHat[] PROGMEM = {
+	0x57, 0x78, 0xB4, 0x9A, 0x8D, 0x4F, 0x9E, 0x8F, 0x52, 0x69, 0xA9, 0x94, 0x8A, 0x85, 0x4F, 0x68,
+	0x74, 0xAC, 0x96, 0x5A, 0x9E, 0x5F, 0x70, 0xA7, 0x93, 0x5B, 0x9C, 0x60, 0x70, 0x78, 0xA9, 0x94,
+	0x8A, 0x5A, 0x98, 0x8C, 0x5B, 0x98, 0x8C, 0x5C, 0x6E, 0xA0, 0x67, 0x74, 0x7A, 0xA4, 0x92, 0x62,
+	0x71, 0x79, 0x7C, 0xA4, 0x6D, 0x9B, 0x69, 0x99, 0x8C, 0x62, 0x95, 0x67, 0x97, 0x8B, 0x63, 0x72,
+	0x79, 0x9E, 0x6E, 0x98, 0x8C, 0x66, 0x93, 0x89, 0x85, 0x82, 0x81, 0x80, 0x62, 0x8F, 0x6A, 0x75,
+	0x98, 0x6F, 0x77, 0x98, 0x70, 0x94, 0x6E, 0x93, 0x6E, 0x77, 0x7C, 0x99, 0x72, 0x79, 0x7D, 0x7E,
+	0x99, 0x8C, 0x6D, 0x76, 0x94, 0x71, 0x91, 0x89, 0x84, 0x82, 0x69, 0x75, 0x92, 0x89, 0x6D, 0x77,
+	0x92, 0x89, 0x6E, 0x77, 0x7C, 0x7E, 0x94, 0x8A, 0x70, 0x78, 0x7C, 0x7E, 0x7F, 0x80, 0x80, 0x94,
+	0x8A, 0x71, 0x8C, 0x86, 0x70, 0x8B, 0x85, 0x83, 0x6F, 0x78, 0x8E, 0x87, 0x83, 0x82, 0x6F, 0x78,
+	0x7C, 0x7E, 0x90, 0x88, 0x73, 0x8A, 0x75, 0x8B, 0x85, 0x73, 0x89, 0x75, 0x8A, 0x75, 0x8A, 0x85,
+	0x82, 0x81, 0x81, 0x80, 0x80, 0x72, 0x87, 0x84, 0x74, 0x7A, 0x8B, 0x78, 0x7C, 0x8C, 0x78, 0x7C,
+	0x8B, 0x79, 0x89, 0x78, 0x89, 0x78, 0x88, 0x78, 0x7C, 0x7E, 0x7F, 0x80, 0x80, 0x8C, 0x86, 0x77,
+	0x7C, 0x7E, 0x7F, 0x8B, 0x7A, 0x7D, 0x8A, 0x7A, 0x88, 0x84, 0x82, 0x76, 0x86, 0x83, 0x77, 0x7C,
+	0x88, 0x7A, 0x7D, 0x88, 0x7A, 0x7D, 0x88, 0x84, 0x82, 0x78, 0x85, 0x79, 0x86, 0x7A, 0x7D, 0x7E,
+	0x7F, 0x80, 0x89, 0x84, 0x79, 0x85, 0x7A, 0x85, 0x7A, 0x85, 0x7B, 0x7D, 0x87, 0x83, 0x82, 0x81,
+	0x80, 0x80, 0x80, 0x78, 0x7C, 0x7E, 0x86, 0x83, 0x82, 0x81, 0x80, 0x80, 0x79, 0x7D, 0x85, 0x83,
+	0x7A, 0x7D, 0x7F, 0x7F, 0x86, 0x83, 0x7B, 0x84, 0x82, 0x81, 0x7A, 0x7D, 0x7F, 0x85, 0x83, 0x7B,
+	0x84, 0x82, 0x81, 0x7B, 0x83, 0x82, 0x7B, 0x7E, 0x7F, 0x7F, 0x85, 0x83, 0x7C, 0x83, 0x82, 0x81,
+	0x80, 0x7B, 0x83, 0x81, 0x81, 0x7B, 0x83, 0x81, 0x81, 0x7C, 0x83, 0x7D, 0x7E, 0x7F, 0x84, 0x82,
+	0x81, 0x81, 0x80, 0x80, 0x80, 0x80, 0x7C, 0x7E, 0x7F, 0x84, 0x7E, 0x7F, 0x84, 0x82, 0x7D, 0x7E,
+	0x7F, 0x84, 0x82, 0x7D, 0x7E, 0x83, 0x82, 0x7D, 0x82, 0x7D, 0x7F, 0x83, 0x7E, 0x7F, 0x83, 0x7E,
+	0x7F, 0x80, 0x80, 0x83, 0x82, 0x7D, 0x82, 0x7E, 0x7F, 0x7F, 0x80, 0x80, 0x83, 0x7E, 0x7F, 0x83,
+	0x81, 0x81, 0x80, 0x7D, 0x7F, 0x7F, 0x83, 0x81, 0x7E, 0x82, 0x7E, 0x82, 0x81, 0x80, 0x7D, 0x81,
+	0x7E, 0x7F, 0x80, 0x82, 0x81, 0x81, 0x80, 0x80, 0x7E, 0x81, 0x81, 0x7E, 0x7F, 0x7F, 0x82, 0x7F,
+	0x7F, 0x82, 0x81, 0x80, 0x7E, 0x81, 0x7E, 0x81, 0x81, 0x7E, 0x81, 0x81, 0x7E, 0x81, 0x81, 0x7E,
+	0x81, 0x7F, 0x81, 0x81, 0x80, 0x7E, 0x7F, 0x80, 0x80, 0x80, 0x80, 0x80, 0x81, 0x81, 0x80, 0x7F,
+	0x81, 0x7F, 0x7F, 0x81, 0x81, 0x7F, 0x7F, 0x81, 0x81, 0x7F, 0x7F, 0x81, 0x7F, 0x80, 0x81, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+struct Sample {
+	const uint8_t* data;
+	uint16_t length;
+};
+
+// FRAME_DAC sample numbers
+const struct Sample samples[] PROGMEM = {
+	{sampleKick, sizeof(sampleKick)},
+	{sampleSnare, sizeof(sampleSnare)},
+	{sampleHat, sizeof(sampleHat)},
+};
+
+#define NUM_SAMPLES (sizeof(samples) / sizeof(struct Sample))
+
+#endif /* SAMPLES_H_ */